@@ -3,23 +3,14 @@
 #include <util/atomic.h>
 
 Scheduler::Timer Scheduler::timers[MAX_TIMERS_COUNT];
-uint8_t Scheduler::timersCount = 0;
-TaskPointer Scheduler::taskQueue[MAX_TASK_QUEUE_SIZE];
-uint8_t Scheduler::taskQueueSize = 0;
+volatile uint8_t Scheduler::timersCount = 0;
+SpscQueue<TaskPointer, MAX_TASK_QUEUE_SIZE> Scheduler::taskQueue;
 
+// The main loop is the only consumer, so taking a task needs no interrupt masking
 void Scheduler::processTasks() {
     TaskPointer currentTask;
-
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        if(taskQueueSize == 0) {
-            return; // Idle();
-        }
-
-        currentTask = taskQueue[0];
-        taskQueueSize--;
-        for(uint8_t i = 0; i < taskQueueSize; i++) {
-            taskQueue[i] = taskQueue[i + 1];
-        }
+    if(!taskQueue.pop(currentTask)) {
+        return; // Idle();
     }
     currentTask();
 }
@@ -46,14 +37,10 @@ bool Scheduler::setTimer(TaskPointer task, uint16_t period_ticks, bool periodic)
     return true;
 }
 
+// Tasks are set from the main loop and from ISRs, the producer side is serialized
 bool Scheduler::setTask(TaskPointer task) {
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        if(taskQueueSize == MAX_TASK_QUEUE_SIZE) {
-            return false;
-        }
-
-        taskQueue[taskQueueSize] = task;
-        taskQueueSize++;
+        return taskQueue.push(task);
     }
-    return true;
+    return false;
 }
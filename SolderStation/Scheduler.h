@@ -2,6 +2,9 @@
 #define SCHEDULER_H_
 
 #include <stdint.h>
+#include <util/atomic.h>
+
+#include "shared.hpp"
 
 const uint8_t MAX_TIMERS_COUNT = 8;
 const uint8_t MAX_TASK_QUEUE_SIZE = 8;
@@ -17,9 +20,8 @@ class Scheduler {
         } Timer;
 
         static Timer timers[MAX_TIMERS_COUNT];
-        static uint8_t timersCount;
-        static TaskPointer taskQueue[MAX_TASK_QUEUE_SIZE];
-        static uint8_t taskQueueSize;
+        static volatile uint8_t timersCount; // timers may be added from ISRs while TimerISR runs
+        static SpscQueue<TaskPointer, MAX_TASK_QUEUE_SIZE> taskQueue; // the producers are serialized
 
     public:
         static void processTasks();
@@ -39,8 +41,10 @@ class Scheduler {
                 if(timers[i].period != 0) { // reset timer
                     timers[i].counter = timers[i].period;
                 } else {                    // delete timer
-                    timersCount--;
-                    timers[i] = timers[timersCount];
+                    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                        timersCount--;
+                        timers[i] = timers[timersCount];
+                    }
                     i--;
                 }
             }
@@ -4,130 +4,198 @@
 #include <avr/interrupt.h>
 #include <avr/wdt.h>
 #include <avr/power.h>
+#include <avr/pgmspace.h>
 
 extern "C" {
     #include "pid/pid.h"
 }
 
-const float K_P = 2.50;
-const float K_I = 0.01;
-const float K_D = 15.00;
-
 struct PID_DATA fanPidData;
 
 #include "utils.h"
 #include "config.h"
 #include "Scheduler.h"
+#include "clock.h"
 #include "AVRPin.hpp"
 #include "calibrator.h"
 #include "lcd.h"
 #include "peripherals.h"
+#include "sweep.h"
+#include "params.h"
+#include "events.h"
+#include "buttons.h"
+#include "faults.h"
+#include "meter.h"
+#include "cooling.h"
+#include "standby.h"
+#include "profile.h"
+#include "latency.hpp"
+#include "capture.hpp"
+#include "stack.h"
 
 #ifdef SOFTUART
     #include "softuart.hpp"
 #endif
 
-enum Mode {SOLDER, FAN, FAN_CALIBRATION, SOLDER_CALIBRATION};
+enum Mode {SOLDER, FAN, FAN_CALIBRATION, SOLDER_CALIBRATION, FAN_SWEEP, SOLDER_SWEEP, PARAMS, FAN_PROFILE};
 enum FanMode {OFF, SLEEP, COOLING, ON};
 
 Mode mode = Mode::SOLDER;
 FanMode fanMode = FanMode::OFF;
 
 uint16_t solderSetupTemp = TEMPERATURE_MIN;
+uint16_t fanTemp = 0;    // last measured temperatures, the display uses these
+uint16_t solderTemp = 0;
 uint16_t fanSetupTemp = TEMPERATURE_MIN;
 uint16_t calibratorColdTemp;
 uint16_t calibratorFanTemp;
 uint16_t calibratorSolderTemp;
+Param param = PARAM_FAN_THRESHOLD;
 
-uint16_t pwr = 0;
+const char MSG_OFF[] PROGMEM = "OFF";
+const char MSG_SLEEP[] PROGMEM = "SLP";
+const char MSG_FAULTS[FAULTS_COUNT - 1][4] PROGMEM = {"E-1", "E-2", "E-3", "E-4", "E-5"}; // by Fault code
+const char MSG_DASHES[] PROGMEM = "---";
+const char MSG_SWEEP[] PROGMEM = "CAL";
+const char MSG_SEGMENTS[PROFILE_SEGMENTS][4] PROGMEM = {"S-1", "S-2", "S-3", "S-4", "S-5", "S-6"};
 
 void processFan() {
     static bool pid_init = true;
-    static uint8_t cooling_timeout = 0;
-    uint16_t currentTemp = Peripherals::getFanTemp();
-    bool heaterOn = Peripherals::isFanSwitchOn() && !Peripherals::isFanOnSeat();
+    static uint16_t setupTemp = 0; // of the previous tick, the power was applied for it
+    uint16_t currentTemp = FanHeater::getTemp();
+    if(currentTemp != fanTemp) {
+        fanTemp = currentTemp;
+        Events::post(EVENT_SENSOR);
+    }
+
+    Fault fault = Faults::check(FAN_CHANNEL, FanHeater::getAverageAdc(), currentTemp, setupTemp, FanHeater::getPower(),
+                                FanHeater::isSwitchOn());
+    FanMode oldFanMode = fanMode;
+    bool heaterOn = FanHeater::isSwitchOn() && !Peripherals::isFanOnSeat() && fault == FAULT_NONE &&
+                    mode != Mode::PARAMS; // no heating under half edited parameters
     
     // AirFlow
-    static bool coolingRequirement = false;
-    if(currentTemp > (FAN_THRESHOLD_TEMP + FAN_HYSTERESIS_TEMP)) {
-        coolingRequirement = true;
-        cooling_timeout = FAN_COOLING_TIMEOUT * 10; // sec * 10 * 100ms per call
-    }
-    if(currentTemp <= FAN_THRESHOLD_TEMP) {
-        if(cooling_timeout == 0) {
-            coolingRequirement = false;
-        } else {
-            cooling_timeout--;
-        }
+    Cooling::process(currentTemp, FanHeater::getPower());
+
+    if(!heaterOn && Profile::isRunning()) { // put on the seat or switched off
+        Profile::stop();
+        Events::post(EVENT_DISPLAY);
     }
-    
+
     if (heaterOn) {
         fanMode = FanMode::ON;
-        uint8_t velocity = map(Peripherals::getAirFlowAjustment(), 0, 1023, FAN_AIR_FLOW_MIN, FAN_AIR_FLOW_MAX);
+        uint8_t velocity;
+        if(Profile::isRunning()) {
+            velocity = map(Profile::getAirFlow(), 0, 100,
+                           Params::get(PARAM_FAN_AIR_FLOW_MIN), Params::get(PARAM_FAN_AIR_FLOW_MAX));
+        } else {
+            velocity = map(Peripherals::getAirFlowAjustment(), 0, 1023,
+                           Params::get(PARAM_FAN_AIR_FLOW_MIN), Params::get(PARAM_FAN_AIR_FLOW_MAX));
+        }
         Peripherals::setAirFlowVelocity(velocity);
-    } else if(coolingRequirement) {
+    } else if(Cooling::isActive()) {
         fanMode = FanMode::COOLING;
-        Peripherals::setAirFlowVelocity(FAN_AIR_FLOW_MAX);
+        Peripherals::setAirFlowVelocity(Cooling::getAirFlow());
     } else {
         Peripherals::setAirFlowVelocity(0);
-        fanMode = Peripherals::isFanSwitchOn() ? FanMode::SLEEP : FanMode::OFF;
+        fanMode = FanHeater::isSwitchOn() ? FanMode::SLEEP : FanMode::OFF;
+    }
+
+    if(fanMode != oldFanMode) {
+        Events::post(EVENT_DISPLAY);
     }
 
     // Heat
     if(!heaterOn) {
-        Peripherals::setFanPower(0);
+        FanHeater::setPower(0);
         pid_init = true;
         return;
     }
 
     if (pid_init) {
         pid_init = false;
-        pid_Init(K_P * SCALING_FACTOR,  K_I * SCALING_FACTOR, K_D * SCALING_FACTOR, &fanPidData);
+        pid_Init(Params::get(PARAM_FAN_KP) * (SCALING_FACTOR / 16),
+                 Params::get(PARAM_FAN_KI),
+                 Params::get(PARAM_FAN_KD) * (SCALING_FACTOR / 16), &fanPidData);
     }
     
-    int16_t inputValue = pid_Controller(fanSetupTemp, currentTemp, &fanPidData);
-    uint8_t power = clamp(inputValue, 0, 100);
-    pwr = power;
-    Peripherals::setFanPower(power);
+    setupTemp = fanSetupTemp;
+    if(mode == Mode::FAN_SWEEP) {
+        setupTemp = Sweep::getSetpoint();
+    } else if(Profile::isRunning()) {
+        setupTemp = Profile::getSetpoint();
+    }
+    int16_t inputValue = pid_Controller(setupTemp, currentTemp, &fanPidData);
+    uint8_t power = clamp<int16_t>(inputValue, 0, 100);
+    FanHeater::setPower(power);
 }
 
 void processSolder() {
-    if(!Peripherals::isSolderSwitchOn()) {
-        Peripherals::setSolderPower(0);
+    static uint16_t setupTemp = 0; // of the previous tick, the power was applied for it
+    uint16_t currentTemp = SolderHeater::getTemp();
+    if(currentTemp != solderTemp) {
+        solderTemp = currentTemp;
+        Events::post(EVENT_SENSOR);
+    }
+
+    Fault fault = Faults::check(SOLDER_CHANNEL, SolderHeater::getAverageAdc(), currentTemp, setupTemp,
+                                SolderHeater::getPower(), SolderHeater::isSwitchOn());
+    if(!SolderHeater::isSwitchOn() || fault != FAULT_NONE || mode == Mode::PARAMS) {
+        SolderHeater::setPower(0);
         return;
     }
 
-    uint16_t currentTemp = Peripherals::getSolderTemp();        
-    if(currentTemp > solderSetupTemp) {
-       Peripherals::setSolderPower(0);
+    if(mode == Mode::SOLDER_SWEEP) {
+        setupTemp = Sweep::getSetpoint();
+        Standby::wake();
     } else {
-       Peripherals::setSolderPower(100);
+        setupTemp = Standby::process(currentTemp, solderSetupTemp, SolderHeater::getPower());
+    }
+
+    if(currentTemp > setupTemp) {
+       SolderHeater::setPower(0);
+    } else {
+       SolderHeater::setPower(100);
     }
 }
 
-uint16_t lastChangeTimeout = 0;
-uint8_t recentlyChangedTimeout = 0;
+Deadline lastChangeTimeout;
+Deadline recentlyChangedTimeout;
+Deadline activityTimeout;
 
 bool isChangeMode() {
-    return lastChangeTimeout != 0;
+    return lastChangeTimeout.isRunning();
 }
 
 bool isRecentlyChanged() {
-    return recentlyChangedTimeout != 0;
+    return recentlyChangedTimeout.isRunning();
 }
 
 void changeModeOn() {
-    lastChangeTimeout = CHANGE_MODE_DELAY;
-    recentlyChangedTimeout = 2;
+    lastChangeTimeout.start(CHANGE_MODE_DELAY);
+    recentlyChangedTimeout.start(RECENTLY_CHANGED_DELAY);
+}
+
+void activityOn() {
+    activityTimeout.start(LCD_DIM_DELAY);
+    Standby::wake();
+}
+
+bool isIdle() {
+    return !activityTimeout.isRunning() &&
+           fanMode != FanMode::ON &&
+           fanMode != FanMode::COOLING &&
+           (!SolderHeater::isSwitchOn() || Standby::isActive());
 }
 
+// Expired timeouts change what is displayed
 void processTimeouts() {
-    if (lastChangeTimeout != 0) {
-        lastChangeTimeout--;
-    }
+    bool expired = lastChangeTimeout.expire();
+    expired |= activityTimeout.expire();
+    expired |= recentlyChangedTimeout.expire();
 
-    if (recentlyChangedTimeout != 0) {
-        recentlyChangedTimeout--;
+    if(expired) {
+        Events::post(EVENT_DISPLAY);
     }
 }
 
@@ -136,21 +204,35 @@ void processSwitches() {
     static bool solderSwitchOld = false;
     static bool fanSeat = false;
 
-    bool fan_changed = Peripherals::isFanSwitchOn() != fanSwitchOld ||
+    bool fan_changed = FanHeater::isSwitchOn() != fanSwitchOld ||
                        Peripherals::isFanOnSeat() != fanSeat;
 
-    bool solder_changed = Peripherals::isSolderSwitchOn() != solderSwitchOld;
+    bool solder_changed = SolderHeater::isSwitchOn() != solderSwitchOld;
+
+    if(fan_changed || solder_changed) {
+        activityOn();
+    }
 
-    if(fan_changed && Peripherals::isFanSwitchOn()) {
+    // the parameter menu is only left by holding SET, which saves the parameters
+    if(fan_changed && FanHeater::isSwitchOn() && mode != Mode::PARAMS) {
         mode = Mode::FAN;
     }
 
-    if(solder_changed && Peripherals::isSolderSwitchOn()) {
+    if(solder_changed && SolderHeater::isSwitchOn() && mode != Mode::PARAMS) {
         mode = Mode::SOLDER;
     }
 
-    fanSwitchOld = Peripherals::isFanSwitchOn();
-    solderSwitchOld = Peripherals::isSolderSwitchOn();
+    // switching a heater on again acknowledges its fault
+    if(FanHeater::isSwitchOn() && !fanSwitchOld) {
+        Faults::clear(FAN_CHANNEL);
+    }
+
+    if(SolderHeater::isSwitchOn() && !solderSwitchOld) {
+        Faults::clear(SOLDER_CHANNEL);
+    }
+
+    fanSwitchOld = FanHeater::isSwitchOn();
+    solderSwitchOld = SolderHeater::isSwitchOn();
     fanSeat = Peripherals::isFanOnSeat();
 }
 
@@ -164,9 +246,11 @@ uint16_t& getCurrentModeValue() {
             return solderSetupTemp;
 
         case FAN_CALIBRATION:
+        case FAN_SWEEP:
             return calibratorFanTemp;
 
         case SOLDER_CALIBRATION:
+        case SOLDER_SWEEP:
             return calibratorSolderTemp;
 
         default: 
@@ -174,39 +258,61 @@ uint16_t& getCurrentModeValue() {
     }
 }
 
-void changeButtonsClick(bool isUp) {
+bool isSweepMode() {
+    return mode == Mode::FAN_SWEEP || mode == Mode::SOLDER_SWEEP;
+}
+
+void changeButtonsClick(bool isUp, uint8_t step) {
+    if(mode == Mode::FAN_PROFILE) { // choose a profile, a running one is not adjusted
+        if(!Profile::isRunning()) {
+            Profile::select(isUp);
+            Events::post(EVENT_DISPLAY);
+        }
+        return;
+    }
+
+    if(isSweepMode() && Sweep::getState() != Sweep::REFERENCE) {
+        return; // nothing to adjust while the heater settles
+    }
+
     changeModeOn();
-    int8_t delta = isUp ? +1 : -1;
+    Events::post(EVENT_SETPOINT);
+    int8_t delta = isUp ? step : -step;
+    if(mode == Mode::PARAMS) {
+        Params::set(param, Params::get(param) + delta);
+        return;
+    }
+
     uint16_t &value = getCurrentModeValue();
-    value = clamp(value + delta, TEMPERATURE_MIN, TEMPERATURE_MAX);
+    value = clamp<uint16_t>(value + delta, TEMPERATURE_MIN, TEMPERATURE_MAX);
 }
 
 void buttonSetClick() {
     switch(mode) {
         case SOLDER_CALIBRATION:
-            if(calibratorSolderTemp >= HOT_CALIBRATION_TEMP) {
-                Calibrator::setHotSolderCalibration(calibratorSolderTemp);
-            }
-
-            if(calibratorSolderTemp <= COLD_CALIBRATION_TEMP) {
-                Calibrator::setColdSolderCalibration(calibratorSolderTemp);
-            }
+            Calibrator::addPoint(SOLDER_CHANNEL, SolderHeater::getAverageAdc(), calibratorSolderTemp);
 
             mode = Mode::SOLDER;
         break;
 
         case FAN_CALIBRATION:
-            if(calibratorFanTemp >= HOT_CALIBRATION_TEMP) {
-                Calibrator::setHotFanCalibration(calibratorFanTemp);
-            }
-
-            if(calibratorFanTemp <= COLD_CALIBRATION_TEMP) {
-                Calibrator::setColdFanCalibration(calibratorFanTemp);
-            }
+            Calibrator::addPoint(FAN_CHANNEL, FanHeater::getAverageAdc(), calibratorFanTemp);
 
             mode = Mode::FAN;
         break;
 
+        case FAN_SWEEP:
+            Sweep::confirm(calibratorFanTemp);
+        break;
+
+        case PARAMS:
+            param = static_cast<Param>(param + 1 < PARAMS_COUNT ? param + 1 : 0);
+        break;
+
+        case SOLDER_SWEEP:
+            Sweep::confirm(calibratorSolderTemp);
+        break;
+
         case FAN:
             mode = Mode::SOLDER;
         break;
@@ -215,6 +321,12 @@ void buttonSetClick() {
             mode = Mode::FAN;
         break;
 
+        case FAN_PROFILE:
+            if(!Profile::isRunning()) {
+                Profile::start(FanHeater::getTemp());
+            }
+        break;
+
         default: ;
     }
 }
@@ -222,110 +334,177 @@ void buttonSetClick() {
 void buttonSetHold() {
     switch(mode) {
         case FAN:
-            mode = Mode::FAN_CALIBRATION;
-            calibratorFanTemp = Peripherals::getFanTemp();
+            mode = Mode::FAN_PROFILE;
+        break;
+
+        case FAN_PROFILE:
+            if(Profile::isRunning()) { // abort
+                Profile::stop();
+                mode = Mode::FAN;
+            } else {
+                mode = Mode::FAN_CALIBRATION;
+                calibratorFanTemp = FanHeater::getTemp();
+            }
         break;
 
         case SOLDER:
             mode = Mode::SOLDER_CALIBRATION;
-            calibratorSolderTemp = Peripherals::getSolderTemp();
+            calibratorSolderTemp = SolderHeater::getTemp();
+        break;
+
+        case FAN_CALIBRATION:
+            mode = Mode::FAN_SWEEP;
+            Sweep::start(FAN_CHANNEL);
+        break;
+
+        case SOLDER_CALIBRATION:
+            mode = Mode::SOLDER_SWEEP;
+            Sweep::start(SOLDER_CHANNEL);
+        break;
+
+        case FAN_SWEEP: // abort
+            mode = Mode::FAN;
+        break;
+
+        case SOLDER_SWEEP: // abort
+            mode = Mode::SOLDER;
+        break;
+
+        case PARAMS:
+            Params::save();
+            Buttons::setHoldDelay(Params::get(PARAM_LONG_PRESS_DELAY));
+            mode = Mode::SOLDER;
         break;
 
         default: ;
     }
 }
 
+// Button event handler, the display handler subscribed after it shows the result
 void processButtons() {
-    static Button oldButton;
-    static bool firstRun = true;
-    static uint8_t delay = 0;
-    static bool oldHold = false;
-    Button button = Peripherals::getButton();
-
-    if (firstRun) { // eliminates a click when turned on with the button held down
-        oldButton = button;
-        firstRun = false;
-    }
-    
-    bool btnDown = button != oldButton;
-    if(btnDown) {
-        delay = 0;
-    }
-
-    bool btnHold = delay >= LONG_PRESS_DELAY;
-    bool btnFirstHold = !oldHold && btnHold;
-    if (!btnDown && !btnHold) {
-        delay++;
-    }
+    Buttons::Event event;
+    while(Buttons::getEvent(event)) {
+#ifdef CAPTURE
+        Capture::button(event.button, event.action, event.step);
+#endif
+        bool isChange = event.button == UP || event.button == DOWN;
+        switch(event.action) {
+            case Buttons::PRESS:
+                activityOn();
+                if(isChange) {
+                    changeButtonsClick(event.button == UP, 1);
+                }
+            break;
 
-    if((button == UP || button == DOWN) && (btnDown || btnHold)) {
-        changeButtonsClick(button == UP);
-    }
+            case Buttons::REPEAT:
+                changeButtonsClick(event.button == UP, event.step);
+            break;
 
-    bool btnSetUp = (oldButton == SET) && btnDown && !oldHold;
-    if(btnSetUp) {
-        buttonSetClick();
-    }
+            case Buttons::CLICK:
+                buttonSetClick();
+            break;
 
-    if((button == SET) && btnFirstHold) {
-        buttonSetHold();
+            case Buttons::HOLD:
+                buttonSetHold();
+            break;
+        }
     }
-    
-    oldHold = btnHold;
-    oldButton = button;
 }
 
+// Display handler, runs only when something shown has changed
 void processLEDs() {
     FanLedPin::Set(mode == Mode::FAN ||
-                   mode == Mode::FAN_CALIBRATION
+                   mode == Mode::FAN_PROFILE ||
+                   mode == Mode::FAN_CALIBRATION ||
+                   mode == Mode::FAN_SWEEP
     );
 
     SolderLedPin::Set(mode == Mode::SOLDER ||
-                      mode == Mode::SOLDER_CALIBRATION
+                      mode == Mode::SOLDER_CALIBRATION ||
+                      mode == Mode::SOLDER_SWEEP
     );
 
     Lcd::setBlink(false);
 
-    bool changeMode = isChangeMode() ||
+    bool changeMode = mode != Mode::PARAMS && (
+                      isChangeMode() ||
                       mode == Mode::FAN_CALIBRATION ||
-                      mode == Mode::SOLDER_CALIBRATION;
+                      mode == Mode::SOLDER_CALIBRATION ||
+                      (isSweepMode() && Sweep::getState() == Sweep::REFERENCE));
 
-    if(mode == Mode::FAN && !changeMode) {
+    if(mode == Mode::PARAMS) { // name / value in rotation, only the value while it is being changed
+        if(!isChangeMode() && Lcd::getField(2) == 0) {
+            Lcd::setText(Params::getName(param));
+        } else {
+            Lcd::setValue(Params::get(param));
+        }
+    }
+
+    if(isSweepMode() && !changeMode) { // CAL / current temperature in rotation while settling
+        if(Lcd::getField(2) == 0) {
+            Lcd::setText(MSG_SWEEP);
+        } else {
+            Lcd::setValue(mode == Mode::FAN_SWEEP ? fanTemp : solderTemp);
+        }
+    }
+
+    if(mode == Mode::FAN_PROFILE) {
+        if(!Profile::isRunning()) { // the profile to start, blinking
+            Lcd::setText(Profile::getName());
+            Lcd::setBlink();
+        } else if(Lcd::getField(2) == 0) { // segment / current temperature in rotation, blinking while held
+            Lcd::setText(MSG_SEGMENTS[Profile::getSegment()]);
+            Lcd::setBlink(Profile::getState() == Profile::HOLD);
+        } else {
+            Lcd::setValue(fanTemp);
+            Lcd::setBlink(Profile::getState() == Profile::HOLD);
+        }
+    }
+
+    Fault fanFault = Faults::get(FAN_CHANNEL);
+    if(mode == Mode::FAN && !changeMode && fanFault != FAULT_NONE) {
+        Lcd::setText(MSG_FAULTS[fanFault - 1]);
+        Lcd::setBlink();
+    } else if(mode == Mode::FAN && !changeMode) {
         switch(fanMode) {
-            case COOLING:
-                Lcd::setOFF();
+            case COOLING: // OFF / current temperature in rotation
+                if(Lcd::getField(2) == 0) {
+                    Lcd::setText(MSG_OFF);
+                } else {
+                    Lcd::setValue(fanTemp);
+                }
                 Lcd::setBlink();
             break;
 
             case SLEEP:
-                Lcd::setSleep();
+                Lcd::setText(MSG_SLEEP);
             break;
 
             case OFF:
-                Lcd::setDashes();
+                Lcd::setText(MSG_DASHES);
                 Lcd::setBlink();
             break;
 
             case ON:
-                if(Peripherals::isFanSensorOk()) {
-                    Lcd::setValue(Peripherals::getFanTemp());
-                } else {
-                    Lcd::setSensorError();
-                    Lcd::setBlink();
-                }
+                Lcd::setValue(fanTemp);
         }
     }
     
     if (mode == Mode::SOLDER && !changeMode) {
-        if(Peripherals::isSolderSwitchOn()) {
-            if(Peripherals::isSolderSensorOk()) {
-                Lcd::setValue(Peripherals::getSolderTemp());
+        Fault solderFault = Faults::get(SOLDER_CHANNEL);
+        if(solderFault != FAULT_NONE) {
+            Lcd::setText(MSG_FAULTS[solderFault - 1]);
+            Lcd::setBlink();
+        } else if(SolderHeater::isSwitchOn() && Standby::isActive()) { // SLP / current temperature in rotation
+            if(Lcd::getField(2) == 0) {
+                Lcd::setText(MSG_SLEEP);
             } else {
-                Lcd::setSensorError();
-                Lcd::setBlink();
+                Lcd::setValue(solderTemp);
             }
+        } else if(SolderHeater::isSwitchOn()) {
+            Lcd::setValue(solderTemp);
         } else {
-            Lcd::setDashes();
+            Lcd::setText(MSG_DASHES);
             Lcd::setBlink();
         }
     }
@@ -335,16 +514,19 @@ void processLEDs() {
         Lcd::setValue(value);
         Lcd::setBlink(!isRecentlyChanged());
     }
+
+    Lcd::setBrightness(Params::get(isIdle() ? PARAM_LCD_STANDBY_BRIGHTNESS : PARAM_LCD_BRIGHTNESS));
 }
 
 void saveSettings() {
     static bool oldChange = false;
     if(!isChangeMode() && oldChange) {
-        uint16_t fanSaved, solderSaved;
-        Calibrator::getSetupTemp(fanSaved, solderSaved);
+        if(fanSetupTemp != Calibrator::getSetupTemp(FAN_CHANNEL)) {
+            Calibrator::setSetupTemp(FAN_CHANNEL, fanSetupTemp);
+        }
 
-        if((fanSetupTemp != fanSaved) || (solderSetupTemp != solderSaved)) {
-            Calibrator::setSetupTemp(fanSetupTemp, solderSetupTemp);
+        if(solderSetupTemp != Calibrator::getSetupTemp(SOLDER_CHANNEL)) {
+            Calibrator::setSetupTemp(SOLDER_CHANNEL, solderSetupTemp);
         }
     }
     oldChange = isChangeMode();
@@ -368,38 +550,135 @@ void printDbg(uint16_t a, uint16_t b, uint16_t c) {
     printValue(c);
     Softuart::sendString("\r\n");
 }
+
+// Once a second: N,noise,windows per reading of both sensors, S,unused,size of the stack
+// and the latency probe
+void printNoise() {
+    static uint8_t delay = 0;
+    if(++delay < 10) {
+        return;
+    }
+    delay = 0;
+
+    Softuart::sendChar('N');
+    for(uint8_t i = 0; i < HEATER_CHANNELS; i++) {
+        Softuart::sendChar(',');
+        printValue(Sampler::getNoise(i));
+        Softuart::sendChar(',');
+        printValue(Sampler::getWindows(i));
+    }
+    Softuart::sendString("\r\n");
+
+    Softuart::sendString("S,");
+    Softuart::sendValue(Stack::getUnused());
+    Softuart::sendChar(',');
+    Softuart::sendValue(Stack::getSize());
+    Softuart::sendString("\r\n");
+
+#ifdef LATENCY_PROBE // L,tick,lcd,adc,zero crossing worst masked cycles
+    Softuart::sendChar('L');
+    for(uint8_t i = 0; i < LATENCY_SOURCES; i++) {
+        Softuart::sendChar(',');
+        printValue(Latency::worst()[i]);
+    }
+    Softuart::sendString("\r\n");
+#endif
+}
 #endif
 
+void processSweep() {
+    if(!isSweepMode()) {
+        Sweep::stop();
+        return;
+    }
+
+    bool isFan = mode == Mode::FAN_SWEEP;
+    uint16_t adc = isFan ? FanHeater::getAverageAdc() : SolderHeater::getAverageAdc();
+    uint16_t temp = Calibrator::convertTemp(Sweep::getChannel(), adc);
+
+    Sweep::State oldState = Sweep::getState();
+    Sweep::process(adc, temp);
+    if(Sweep::getState() != oldState) {
+        Events::post(EVENT_DISPLAY);
+    }
+
+    if(oldState == Sweep::SETTLING && Sweep::getState() == Sweep::REFERENCE) {
+        getCurrentModeValue() = temp; // operator corrects it to the reference reading
+#ifdef SOFTUART
+        printDbg(Sweep::getStep(), adc, temp);
+#endif
+    }
+
+    if(Sweep::getState() == Sweep::DONE) {
+        Sweep::stop();
+        mode = isFan ? Mode::FAN : Mode::SOLDER;
+    }
+}
+
 void loop100ms() {
     wdt_reset();
+#ifdef CAPTURE
+    Capture::inputs(FanHeater::getAverageAdc(), SolderHeater::getAverageAdc(), Peripherals::getAirFlowAjustment(),
+                    FanHeater::isSwitchOn() | SolderHeater::isSwitchOn() << 1 | Peripherals::isFanOnSeat() << 2);
+#endif
     processFan();
     processSolder();
-    processSwitches();
-    processLEDs();
-    saveSettings();
+    processSweep();
+    if(Lcd::render(Peripherals::isHeating())) {
+        Events::post(EVENT_DISPLAY);
+    }
+#ifdef CAPTURE
+    Capture::outputs(FanHeater::getPower(), SolderHeater::getPower(), Peripherals::getAirFlowVelocity(), mode, fanMode,
+                     Faults::get(FAN_CHANNEL) * 10 + Faults::get(SOLDER_CHANNEL), Standby::isActive(),
+                     Profile::getState(), Profile::getSegment());
+#endif
 #ifdef SOFTUART
-    printDbg(fanSetupTemp, Peripherals::getFanTemp(), pwr * 2);
+    printDbg(fanSetupTemp, fanTemp, FanHeater::getPower() * 2);
+    printNoise();
 #endif
 }
 
 void loop10ms() {
-    processButtons();
     processTimeouts();
 }
 
-int main(void) {
+// Everything before the scheduler loop, the host replay (tools/replay) runs it too
+void setup() {
     wdt_enable(WDTO_120MS);
     Peripherals::init();
     Calibrator::init();
-    Calibrator::getSetupTemp(fanSetupTemp, solderSetupTemp);
-    wdt_reset(); // Calibrator::init(); take long time ~80ms
+    Params::init();
+    Meter::init();
+    fanSetupTemp = Calibrator::getSetupTemp(FAN_CHANNEL);
+    solderSetupTemp = Calibrator::getSetupTemp(SOLDER_CHANNEL);
+
+    Buttons::setHoldDelay(Params::get(PARAM_LONG_PRESS_DELAY));
+    if(Buttons::getState() == SET) { // turned on with SET held: parameter menu
+        mode = Mode::PARAMS;
+    }
+
+    // the display handler comes after processSwitches and processButtons, so it shows the mode just selected
+    Events::subscribe(EVENT_SWITCH | EVENT_SEAT, processSwitches);
+    Events::subscribe(EVENT_BUTTON, processButtons);
+    Events::subscribe(EVENT_SETPOINT | EVENT_DISPLAY, saveSettings);
+    Events::subscribe(EVENT_SWITCH | EVENT_SEAT | EVENT_BUTTON | EVENT_SETPOINT | EVENT_SENSOR | EVENT_DISPLAY, processLEDs);
+    Events::post(EVENT_DISPLAY);
+    activityOn();
     sei();
 
 #ifdef SOFTUART
     Softuart::init();
+    Params::print();
+#endif
+#ifdef CAPTURE
+    Capture::boot(Buttons::getState());
 #endif
 
     Scheduler::setTimer(loop10ms, 10, true);
     Scheduler::setTimer(loop100ms, 100, true);
+}
+
+int main(void) {
+    setup();
     Scheduler::run();
 }
@@ -0,0 +1,48 @@
+#include <avr/io.h>
+
+#include "arbiter.h"
+#include "clock.h"
+
+// Crossings of the two detectors closer than this belong to the same mains cycle
+const uint8_t ARBITER_SAME_CYCLE_MS = 5;
+const uint8_t FULL_POWER = 100;
+
+static_assert(POWER_PEAK_BUDGET >= FULL_POWER && POWER_PEAK_BUDGET <= 2 * FULL_POWER, "the budget is 100..200 %");
+
+volatile uint8_t PowerArbiter::requested[HEATER_CHANNELS];
+uint8_t PowerArbiter::granted[HEATER_CHANNELS];
+uint8_t PowerArbiter::fanDebt = 0;
+int8_t PowerArbiter::solderError = 0;
+uint32_t PowerArbiter::planned = 0;
+
+uint8_t PowerArbiter::grantISR(uint8_t channel) {
+    uint32_t now = Clock::millis();
+    if(now - planned >= ARBITER_SAME_CYCLE_MS) {
+        planned = now;
+        plan();
+    }
+    return granted[channel];
+}
+
+void PowerArbiter::plan() {
+    uint8_t solder = requested[SOLDER_CHANNEL];
+    solderError -= solder;
+    bool pulse = solderError < 0;
+    if(pulse) {
+        solderError += FULL_POWER;
+    }
+    granted[SOLDER_CHANNEL] = pulse ? FULL_POWER : 0;
+
+    uint8_t fan = requested[FAN_CHANNEL];
+    if(fan == 0) {
+        fanDebt = 0; // switched off, nothing is owed
+    }
+    uint8_t room = pulse ? POWER_PEAK_BUDGET - FULL_POWER : FULL_POWER;
+    uint16_t want = fan + fanDebt;
+    uint8_t grant = (want < room) ? want : room;
+    granted[FAN_CHANNEL] = grant;
+
+    // the debt is bounded, a budget too small for both requests costs the fan power, not the solder
+    uint16_t debt = want - grant;
+    fanDebt = (debt < FULL_POWER) ? debt : FULL_POWER;
+}
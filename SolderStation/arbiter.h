@@ -0,0 +1,39 @@
+#ifndef ARBITER_H_
+#define ARBITER_H_
+
+#include <stdint.h>
+
+#include "config.h"
+
+// Shares the mains cycles between the heaters so that their conduction never adds up to more
+// than POWER_PEAK_BUDGET percent of one heater at full power. The solder channel is pulse
+// skipped, whole cycles at 100 %, the fan is phase fired at any level. The solder pulses keep
+// their Bresenham spacing, in a cycle with a pulse the fan gets at most the rest of the budget
+// and what it is short of is paid back in the following cycles without one. So the fan runs
+// at a low phase angle exactly where the solder conducts, and both averages are kept as long
+// as the two requests together fit into the budget on average.
+class PowerArbiter {
+    private:
+        static volatile uint8_t requested[HEATER_CHANNELS];
+        static uint8_t granted[HEATER_CHANNELS];
+        static uint8_t fanDebt;     // percent the fan was granted less than requested
+        static int8_t solderError;
+        static uint32_t planned;    // ms of the last plan
+
+        static void plan();
+
+    public:
+        static void request(uint8_t channel, uint8_t power) {
+            requested[channel] = power;
+        }
+
+        static uint8_t getRequest(uint8_t channel) {
+            return requested[channel];
+        }
+
+        // From the zero-crossing ISRs. The first of the two crossings of a cycle plans the
+        // cycle for both channels, the other one picks up its share.
+        static uint8_t grantISR(uint8_t channel);
+};
+
+#endif /* ARBITER_H_ */
@@ -0,0 +1,119 @@
+#include <avr/io.h>
+
+#include "buttons.h"
+#include "config.h"
+#include "events.h"
+
+const uint8_t BUTTONS_DEBOUNCE_SAMPLES = BUTTONS_DEBOUNCE_DELAY / BUTTONS_SAMPLE_PERIOD;
+const uint8_t BUTTONS_REPEAT_DELAY_SAMPLES = BUTTONS_REPEAT_DELAY / BUTTONS_SAMPLE_PERIOD;
+const uint8_t BUTTONS_REPEAT_SAMPLES = BUTTONS_REPEAT_PERIOD / BUTTONS_SAMPLE_PERIOD;
+const uint8_t BUTTONS_REPEAT_FAST_SAMPLES = BUTTONS_REPEAT_FAST_PERIOD / BUTTONS_SAMPLE_PERIOD;
+
+SpscQueue<Buttons::Event, BUTTONS_QUEUE_SIZE> Buttons::queue;
+volatile uint16_t Buttons::level = 1023;
+volatile uint8_t Buttons::holdDelay = LONG_PRESS_DELAY;
+Button Buttons::state = NONE;
+
+Button Buttons::decode(uint16_t value) {
+    if(value < 500) {
+        return Button::UP;
+    }
+
+    if (value < 700) {
+        return Button::DOWN;
+    }
+
+    if (value < 900) {
+        return Button::SET;
+    }
+
+    return Button::NONE;
+}
+
+// A button held at power on is taken as already held, its release is not a click
+void Buttons::init(uint16_t value) {
+    level = value;
+    state = decode(value);
+}
+
+// Called from the 1 ms timer ISR, returns true when a new conversion has to be started
+bool Buttons::tickISR() {
+    static uint8_t sampleTicks = 0;
+    static Button candidate = NONE;
+    static uint8_t stable = 0;
+    static uint16_t heldSamples = 0;
+    static uint8_t repeats = 0;
+    static bool held = true;
+
+    if(++sampleTicks < BUTTONS_SAMPLE_PERIOD) {
+        return false;
+    }
+    sampleTicks = 0;
+
+    Button button = decode(atomicRead(level));
+    if(button != candidate) {
+        candidate = button;
+        stable = 0;
+    } else if(stable < BUTTONS_DEBOUNCE_SAMPLES) {
+        stable++;
+    }
+
+    if(stable == BUTTONS_DEBOUNCE_SAMPLES && candidate != state) {
+        if(state == SET && !held) {
+            push(SET, CLICK);
+        }
+
+        state = candidate;
+        heldSamples = 0;
+        repeats = 0;
+        held = false;
+        if(state != NONE) {
+            push(state, PRESS);
+        }
+        return true;
+    }
+
+    if(state == NONE || held) {
+        return true;
+    }
+
+    heldSamples++;
+    if(state == SET) {
+        if(heldSamples >= holdDelay * (10u / BUTTONS_SAMPLE_PERIOD)) { // 10 ms units to samples
+            held = true;
+            push(SET, HOLD);
+        }
+        return true;
+    }
+
+    uint8_t period = repeats == 0 ? BUTTONS_REPEAT_DELAY_SAMPLES :
+                     repeats < BUTTONS_REPEAT_FAST ? BUTTONS_REPEAT_SAMPLES : BUTTONS_REPEAT_FAST_SAMPLES;
+    if(heldSamples >= period) {
+        heldSamples = 0;
+        uint8_t step = repeats < BUTTONS_REPEAT_FAST ? 1 : repeats < BUTTONS_REPEAT_FAST * 2 ? 5 : 10;
+        if(repeats != 0xff) {
+            repeats++;
+        }
+        push(state, REPEAT, step);
+    }
+    return true;
+}
+
+// Runs in the ISR, an action is dropped if the main loop has not taken the previous ones
+void Buttons::push(Button button, Action action, uint8_t step) {
+    if(queue.push({button, action, step})) {
+        Events::post(EVENT_BUTTON);
+    }
+}
+
+void Buttons::setHoldDelay(uint8_t delay) {
+    holdDelay = delay;
+}
+
+bool Buttons::getEvent(Event &event) {
+    return queue.pop(event);
+}
+
+Button Buttons::getState() {
+    return state;
+}
@@ -0,0 +1,50 @@
+#ifndef BUTTONS_H_
+#define BUTTONS_H_
+
+#include <stdint.h>
+
+#include "shared.hpp"
+
+const uint8_t BUTTONS_QUEUE_SIZE = 4;
+
+enum Button { NONE = 0, UP = 1, DOWN = 2, SET = 3 };
+
+// Resistor ladder buttons sampled in the background: the 1 ms tick starts a conversion
+// every BUTTONS_SAMPLE_PERIOD, the ADC interrupt stores the level. Debounced changes,
+// holds and auto-repeats are queued as actions and announced with EVENT_BUTTON.
+class Buttons {
+    public:
+        enum Action {
+            PRESS,  // any button pressed
+            CLICK,  // SET released before the hold delay
+            HOLD,   // SET held for the hold delay
+            REPEAT  // UP/DOWN still held, step grows the longer it is held
+        };
+
+        typedef struct {
+            Button button;
+            Action action;
+            uint8_t step;
+        } Event;
+
+    private:
+        static SpscQueue<Event, BUTTONS_QUEUE_SIZE> queue; // tick ISR to main loop
+        static volatile uint16_t level;
+        static volatile uint8_t holdDelay;
+        static Button state;
+
+        static Button decode(uint16_t value);
+        static void push(Button button, Action action, uint8_t step = 1);
+
+    public:
+        static void init(uint16_t value);
+        static bool tickISR();
+        static void conversionISR(uint16_t value) {
+            level = value;
+        }
+        static void setHoldDelay(uint8_t delay); // 10 ms units
+        static bool getEvent(Event &event);
+        static Button getState();
+};
+
+#endif /* BUTTONS_H_ */
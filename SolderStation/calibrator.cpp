@@ -1,89 +1,235 @@
+#include <stdlib.h>
+
 #include "calibrator.h"
-#include "peripherals.h"
 #include "config.h"
+#include "utils.h"
+#include "events.h"
 
 Calibrator::CalibrationData Calibrator::data;
-Calibrator::CalibrationData EEMEM Calibrator::eepromDataAddr;
-const uint16_t MAGIC = 0xC0DE;
+bool Calibrator::dirty = false;
+Calibrator::Curve Calibrator::curves[HEATER_CHANNELS];
+const uint8_t SLOPE_SHIFT = 12;
 
-uint16_t remap(uint16_t value, uint16_t oldMin, uint16_t oldMax, uint16_t newMin, uint16_t newMax) {
-    uint16_t oldRange = oldMax - oldMin;
-    uint16_t newRange = newMax - newMin;
-    int16_t result = ((static_cast<int32_t>(value) - oldMin) * newRange) / oldRange + newMin;
+// Bump on every CalibrationData layout change and teach migrate() the previous one
+const uint8_t CALIBRATION_VERSION = 2;
+uint8_t EEMEM Calibrator::journalData[CALIBRATION_JOURNAL_SLOTS][JournalSlotSize];
+Journal Calibrator::journal(journalData, JournalSlotSize, CALIBRATION_JOURNAL_SLOTS);
 
-    return (result >= 0) ? result : 0;
-}
+// Two-point struct of the firmware before the journal, stored at the start of the EEPROM
+const uint16_t LEGACY_MAGIC_TWO_POINT = 0xC0DE;
+const uint8_t *const LEGACY_ADDRESS = 0;
 
+// A sensor the stored data gives no usable curve for falls back to its defaults
 void Calibrator::init() {
-    eeprom_read_block(&data, &eepromDataAddr, sizeof(data));
-    if(data.magic != MAGIC) { // set defaults
-        data.magic = MAGIC;
-        data.fan.coldTemp = 101;
-        data.fan.coldAdc = 219;
-        data.fan.hotTemp = 300;
-        data.fan.hotAdc = 639;
-        data.solder.coldTemp = 118;
-        data.solder.coldAdc = 308;
-        data.solder.hotAdc = 604;
-        data.solder.hotTemp = 255;
-
-        data.fan.setupTemp = TEMPERATURE_MIN;
-        data.solder.setupTemp = TEMPERATURE_MIN;
+    uint8_t version = journal.load(&data, sizeof(data));
+    bool migrated = migrate(version);
+    bool changed = (version != CALIBRATION_VERSION);
+    for(uint8_t i = 0; i < HEATER_CHANNELS; i++) {
+        if(!migrated || !isValid(data.sensors[i])) {
+            setDefaults(i);
+            changed = true;
+        }
+        compile(i);
+    }
+
+    Events::subscribe(EVENT_SETTINGS | EVENT_STORAGE, process);
+    if(changed) {
         save();
     }
 }
 
-void Calibrator::save() {
-    eeprom_update_block(&data, &eepromDataAddr, sizeof(data));
+bool Calibrator::migrate(uint8_t version) {
+    switch(version) {
+        case CALIBRATION_VERSION:
+            return true;
+
+        case 1: // 10 bit adc points
+            scalePoints();
+            return true;
+
+        case 0: { // nothing in the journal, look for the pre-journal layouts
+            uint16_t legacy[11];
+            eeprom_read_block(legacy, LEGACY_ADDRESS, sizeof(legacy));
+
+            if(legacy[0] == LEGACY_MAGIC_TWO_POINT) {
+                data.sensors[FAN_CHANNEL].count = 2;
+                data.sensors[FAN_CHANNEL].points[0] = {legacy[1], legacy[2]};
+                data.sensors[FAN_CHANNEL].points[1] = {legacy[3], legacy[4]};
+                data.sensors[FAN_CHANNEL].setupTemp = legacy[5];
+                data.sensors[SOLDER_CHANNEL].count = 2;
+                data.sensors[SOLDER_CHANNEL].points[0] = {legacy[6], legacy[7]};
+                data.sensors[SOLDER_CHANNEL].points[1] = {legacy[8], legacy[9]};
+                data.sensors[SOLDER_CHANNEL].setupTemp = legacy[10];
+                scalePoints();
+                return true;
+            }
+            return false;
+        }
+
+        default: // record from a newer firmware
+            return false;
+    }
 }
 
-void Calibrator::setColdFanCalibration(uint16_t temp) {
-    data.fan.coldTemp = temp;
-    data.fan.coldAdc = Peripherals::getFanAverageAdc();
-    save();
+void Calibrator::setDefaults(uint8_t channel) {
+    static const Point DEFAULT_POINTS[HEATER_CHANNELS][2] = {
+        {{219 << ADC_OVERSAMPLING_BITS, 101}, {639 << ADC_OVERSAMPLING_BITS, 300}}, // FAN_CHANNEL
+        {{308 << ADC_OVERSAMPLING_BITS, 118}, {604 << ADC_OVERSAMPLING_BITS, 255}}  // SOLDER_CHANNEL
+    };
+
+    SensorData &sensor = data.sensors[channel];
+    sensor.count = 2;
+    sensor.points[0] = DEFAULT_POINTS[channel][0];
+    sensor.points[1] = DEFAULT_POINTS[channel][1];
+    sensor.setupTemp = TEMPERATURE_MIN;
 }
 
-void Calibrator::setHotFanCalibration(uint16_t temp) {
-    data.fan.hotAdc = Peripherals::getFanAverageAdc();
-    data.fan.hotTemp = temp;
-    save();
+// The curve needs 2..CALIBRATION_POINTS points, adc and temperature both rising
+bool Calibrator::isValid(const SensorData &sensor) {
+    if(sensor.count < 2 || sensor.count > CALIBRATION_POINTS) {
+        return false;
+    }
+    for(uint8_t i = 1; i < sensor.count; i++) {
+        if(sensor.points[i].adc <= sensor.points[i - 1].adc || sensor.points[i].temp <= sensor.points[i - 1].temp) {
+            return false;
+        }
+    }
+    return true;
 }
 
-uint16_t Calibrator::getColdFanCalibrationTemp() {
-    return data.fan.coldTemp;
+// Converts points taken as plain 10 bit readings to the oversampled scale
+void Calibrator::scalePoints() {
+    for(uint8_t i = 0; i < HEATER_CHANNELS; i++) {
+        for(uint8_t j = 0; j < data.sensors[i].count && j < CALIBRATION_POINTS; j++) {
+            data.sensors[i].points[j].adc <<= ADC_OVERSAMPLING_BITS;
+        }
+    }
 }
 
-void Calibrator::setColdSolderCalibration(uint16_t temp) {
-    data.solder.coldTemp = temp;
-    data.solder.coldAdc = Peripherals::getSolderAverageAdc();
-    save();
+void Calibrator::save() {
+    dirty = true;
+    Events::post(EVENT_SETTINGS);
+}
+
+// Event handler, hands the data to the journal once the previous record is written
+void Calibrator::process() {
+    if(dirty && journal.save(&data, sizeof(data), CALIBRATION_VERSION)) {
+        dirty = false;
+    }
 }
 
-void Calibrator::setHotSolderCalibration(uint16_t temp) {
-    data.solder.hotAdc = Peripherals::getSolderAverageAdc();
-    data.solder.hotTemp = temp;
+// Precalculates the fixed-point slope of every segment, so conversion needs no division
+void Calibrator::compile(uint8_t channel) {
+    const SensorData &sensor = data.sensors[channel];
+    Curve &curve = curves[channel];
+    curve.count = sensor.count - 1;
+    for(uint8_t i = 0; i < curve.count; i++) {
+        const Point &from = sensor.points[i];
+        const Point &to = sensor.points[i + 1];
+        Segment &segment = curve.segments[i];
+
+        segment.adc = from.adc;
+        segment.temp = from.temp;
+        int32_t slope = (to.adc == from.adc) ? 0 :
+            ((static_cast<int32_t>(to.temp) - from.temp) << SLOPE_SHIFT) / (static_cast<int16_t>(to.adc) - from.adc);
+        segment.slope = clamp<int32_t>(slope, INT16_MIN, INT16_MAX);
+    }
+}
+
+// A reference that leaves no usable curve, out of order with every stored point, is rejected
+void Calibrator::addPoint(uint8_t channel, uint16_t adc, uint16_t temp) {
+    SensorData &sensor = data.sensors[channel];
+    SensorData previous = sensor;
+    insertPoint(sensor, adc, temp);
+    if(!isValid(sensor)) {
+        sensor = previous;
+        return;
+    }
+    compile(channel);
     save();
 }
 
-uint16_t Calibrator::getColdSolderCalibrationTemp() {
-    return data.solder.coldTemp;
+// The points of a completed sweep replace the stored ones, older points between them would
+// kink the curve. A set that gives no usable curve leaves the stored one in place.
+void Calibrator::setPoints(uint8_t channel, const uint16_t *adc, const uint16_t *temp, uint8_t count) {
+    SensorData &sensor = data.sensors[channel];
+    SensorData previous = sensor;
+    sensor.count = 0;
+    for(uint8_t i = 0; i < count; i++) {
+        insertPoint(sensor, adc[i], temp[i]);
+    }
+    if(!isValid(sensor)) {
+        sensor = previous;
+        return;
+    }
+    compile(channel);
+    save();
 }
 
-uint16_t Calibrator::convertSolderTemp(uint16_t adcValue) {
-    return remap(adcValue, data.solder.coldAdc, data.solder.hotAdc, data.solder.coldTemp, data.solder.hotTemp);
+// The new reference wins: stored points close to it in temperature or out of order with it
+// (hotter at a lower adc, colder at a higher one) are dropped, so temperature keeps rising
+// with the adc. When the table is still full the point nearest in temperature goes.
+void Calibrator::insertPoint(SensorData &sensor, uint16_t adc, uint16_t temp) {
+    uint8_t kept = 0;
+    for(uint8_t i = 0; i < sensor.count; i++) {
+        const Point &point = sensor.points[i];
+        bool close = abs(static_cast<int16_t>(point.temp - temp)) < CALIBRATION_MERGE_TEMP;
+        bool ordered = (point.adc < adc && point.temp < temp) || (point.adc > adc && point.temp > temp);
+        if(!close && ordered) {
+            sensor.points[kept++] = point;
+        }
+    }
+    sensor.count = kept;
+
+    if(sensor.count == CALIBRATION_POINTS) {
+        uint8_t nearest = 0;
+        uint16_t nearestDistance = UINT16_MAX;
+        for(uint8_t i = 0; i < sensor.count; i++) {
+            uint16_t distance = abs(static_cast<int16_t>(sensor.points[i].temp - temp));
+            if(distance < nearestDistance) {
+                nearestDistance = distance;
+                nearest = i;
+            }
+        }
+        for(uint8_t i = nearest; i + 1 < sensor.count; i++) {
+            sensor.points[i] = sensor.points[i + 1];
+        }
+        sensor.count--;
+    }
+
+    // insertion sort step: move the new point to its place by adc
+    uint8_t index = sensor.count++;
+    while(index > 0 && sensor.points[index - 1].adc > adc) {
+        sensor.points[index] = sensor.points[index - 1];
+        index--;
+    }
+    sensor.points[index] = {adc, temp};
 }
 
-uint16_t Calibrator::convertFanTemp(uint16_t adcValue) {
-    return remap(adcValue, data.fan.coldAdc, data.fan.hotAdc, data.fan.coldTemp, data.fan.hotTemp);
+uint16_t Calibrator::convertTemp(uint8_t channel, uint16_t adcValue) {
+    const Curve &curve = curves[channel];
+
+    // the first and the last segment are extrapolated
+    const Segment *segment = &curve.segments[0];
+    for(uint8_t i = 1; i < curve.count; i++) {
+        if(adcValue < curve.segments[i].adc) {
+            break;
+        }
+        segment = &curve.segments[i];
+    }
+
+    int16_t delta = adcValue - segment->adc;
+    int16_t result = segment->temp +
+        ((static_cast<int32_t>(delta) * segment->slope + (1 << (SLOPE_SHIFT - 1))) >> SLOPE_SHIFT);
+
+    return (result >= 0) ? result : 0;
 }
 
-void Calibrator::getSetupTemp(uint16_t &fanTemp, uint16_t &solderTemp) {
-    fanTemp = data.fan.setupTemp;
-    solderTemp = data.solder.setupTemp;
+uint16_t Calibrator::getSetupTemp(uint8_t channel) {
+    return data.sensors[channel].setupTemp;
 }
 
-void Calibrator::setSetupTemp(uint16_t fanTemp, uint16_t solderTemp) {
-    data.fan.setupTemp = fanTemp;
-    data.solder.setupTemp = solderTemp;
+void Calibrator::setSetupTemp(uint8_t channel, uint16_t temp) {
+    data.sensors[channel].setupTemp = temp;
     save();
 }
@@ -3,45 +3,68 @@
 
 #include <avr/eeprom.h>
 
+#include "journal.h"
+#include "config.h"
+
+const uint8_t CALIBRATION_POINTS = 6; // per sensor
+const uint8_t CALIBRATION_JOURNAL_SLOTS = 5;
+
 class Calibrator {
     private:
         typedef struct {
-            uint16_t magic;
-            struct {
-                uint16_t coldAdc;
-                uint16_t coldTemp;
-                uint16_t hotAdc;
-                uint16_t hotTemp;
-                uint16_t setupTemp;
-            } fan;
-            struct {
-                uint16_t coldAdc;
-                uint16_t coldTemp;
-                uint16_t hotAdc;
-                uint16_t hotTemp;
-                uint16_t setupTemp;
-            } solder;
+            uint16_t adc; // with ADC_OVERSAMPLING_BITS fraction bits
+            uint16_t temp;
+        } Point;
+
+        typedef struct {
+            uint8_t count;
+            Point points[CALIBRATION_POINTS]; // sorted by adc
+            uint16_t setupTemp;
+        } SensorData;
+
+        typedef struct {
+            SensorData sensors[HEATER_CHANNELS];
         } CalibrationData;
 
+        typedef struct {
+            uint16_t adc;
+            int16_t temp;
+            int16_t slope; // degrees per adc count, Q4.12
+        } Segment;
+
+        typedef struct {
+            uint8_t count;
+            Segment segments[CALIBRATION_POINTS - 1];
+        } Curve;
+
+        enum { JournalSlotSize = Journal::HeaderSize + sizeof(CalibrationData) };
+
         static CalibrationData data;
-        static CalibrationData EEMEM eepromDataAddr;
+        static bool dirty;
+        static uint8_t EEMEM journalData[CALIBRATION_JOURNAL_SLOTS][JournalSlotSize];
+        static Journal journal;
+        static Curve curves[HEATER_CHANNELS];
         static void save();
-        
+        static bool migrate(uint8_t version);
+        static void setDefaults(uint8_t channel);
+        static bool isValid(const SensorData &sensor);
+        static void scalePoints();
+        static void compile(uint8_t channel);
+        static void insertPoint(SensorData &sensor, uint16_t adc, uint16_t temp);
+
     public:
         static void init();
-        static uint16_t convertSolderTemp(uint16_t adcValue);
-        static uint16_t convertFanTemp(uint16_t adcValue);
-
-        static void setColdFanCalibration(uint16_t temp);
-        static void setHotFanCalibration(uint16_t temp);
-        static uint16_t getColdFanCalibrationTemp();
+        static void process();
+        static uint16_t convertTemp(uint8_t channel, uint16_t adcValue);
+        static void addPoint(uint8_t channel, uint16_t adc, uint16_t temp);
+        static void setPoints(uint8_t channel, const uint16_t *adc, const uint16_t *temp, uint8_t count);
 
-        static void setColdSolderCalibration(uint16_t temp);
-        static void setHotSolderCalibration(uint16_t temp);
-        static uint16_t getColdSolderCalibrationTemp();
+        static uint16_t getSetupTemp(uint8_t channel);
+        static void setSetupTemp(uint8_t channel, uint16_t temp);
 
-        static void getSetupTemp(uint16_t &fanTemp, uint16_t &solderTemp);
-        static void setSetupTemp(uint16_t fanTemp, uint16_t solderTemp);
+        static const Journal &getJournal() {
+            return journal;
+        }
 };
 
 #endif /* CALIBRATOR_H_ */
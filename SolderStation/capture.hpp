@@ -0,0 +1,168 @@
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stdint.h>
+
+#include "config.h"
+#include "clock.h"
+#include "shared.hpp"
+
+// Field trace capture. With CAPTURE defined every 100 ms control tick streams what the
+// control logic read and what it decided, and every button event as it is handled. The
+// host replay (tools/replay) feeds a trace taken on a misbehaving station back through the
+// control modules tick by tick and compares the outputs. Lines over the SOFTUART, decimal
+// fields, times in ms of uptime:
+//
+//   E,store,offset,data         at reset, the EEPROM journals the settings are loaded from
+//       store: C calibration, P parameters; data: up to 32 bytes in hex
+//   H,ms,button                 at reset, the button held then (the parameter menu)
+//   I,ms,fan adc,solder adc,air flow knob,switches,fan crossing us,solder crossing us
+//       switches: bit 0 fan, bit 1 solder, bit 2 gun on the seat; the crossings are the
+//       low 16 bits of Clock::micros() at the latest zero crossing of each channel
+//   B,ms,button,action,step
+//   O,ms,fan power,solder power,air flow pwm,mode,fan mode,faults,standby,profile state,segment,display,blink
+//       faults: fan code * 10 + solder code; display: the three characters shown
+//
+// I comes before the tick is processed, O after it; B lines fall between the ticks.
+
+#ifdef CAPTURE
+
+#ifdef CAPTURE_PUT
+    void CAPTURE_PUT(char ch); // the host replay collects the lines itself
+#else
+    #ifndef SOFTUART
+        #error "CAPTURE streams over the SOFTUART"
+    #endif
+
+    #include "softuart.hpp"
+    #define CAPTURE_PUT Softuart::sendChar
+#endif
+
+#include <avr/eeprom.h>
+
+#include "utils.h"
+#include "journal.h"
+#include "calibrator.h"
+#include "params.h"
+#include "lcd.h"
+
+const uint8_t CAPTURE_BYTES_PER_LINE = 32;
+
+class Capture {
+    private:
+        static void number(uint32_t value) {
+            uint8_t buffer[10];
+            bin2bcd10(value, buffer);
+
+            uint8_t i = 0;
+            while(i < 9 && buffer[i] == 0) { // skip leading zeros
+                i++;
+            }
+            while(i < 10) {
+                CAPTURE_PUT('0' + buffer[i++]);
+            }
+        }
+
+        static void field(uint32_t value) {
+            CAPTURE_PUT(',');
+            number(value);
+        }
+
+        static void begin(char tag) {
+            CAPTURE_PUT(tag);
+            field(Clock::millis());
+        }
+
+        static void end() {
+            CAPTURE_PUT('\r');
+            CAPTURE_PUT('\n');
+        }
+
+        static void hex(uint8_t value) {
+            const char digits[] = "0123456789abcdef";
+            CAPTURE_PUT(digits[value >> 4]);
+            CAPTURE_PUT(digits[value & 0x0f]);
+        }
+
+        static void store(char name, const Journal &journal) {
+            const uint8_t *eeprom = journal.getStart();
+            for(uint16_t offset = 0; offset < journal.getLength(); offset += CAPTURE_BYTES_PER_LINE) {
+                CAPTURE_PUT('E');
+                CAPTURE_PUT(',');
+                CAPTURE_PUT(name);
+                field(offset);
+                CAPTURE_PUT(',');
+                for(uint16_t i = offset; i < offset + CAPTURE_BYTES_PER_LINE && i < journal.getLength(); i++) {
+                    hex(eeprom_read_byte(eeprom + i));
+                }
+                end();
+            }
+        }
+
+    public:
+        static volatile uint16_t *crossings() {
+            static volatile uint16_t us[HEATER_CHANNELS];
+            return us;
+        }
+
+        static inline void zeroCrossISR(uint8_t channel) {
+            crossings()[channel] = Clock::micros();
+        }
+
+        // Before the main loop starts, nothing has been written to the EEPROM yet
+        static void boot(uint8_t button) {
+            store('C', Calibrator::getJournal());
+            store('P', Params::getJournal());
+            begin('H');
+            field(button);
+            end();
+        }
+
+        static void inputs(uint16_t fanAdc, uint16_t solderAdc, uint16_t airFlow, uint8_t switches) {
+            uint16_t fanCrossing = atomicRead(crossings()[FAN_CHANNEL]);
+            uint16_t solderCrossing = atomicRead(crossings()[SOLDER_CHANNEL]);
+            begin('I');
+            field(fanAdc);
+            field(solderAdc);
+            field(airFlow);
+            field(switches);
+            field(fanCrossing);
+            field(solderCrossing);
+            end();
+        }
+
+        static void button(uint8_t button, uint8_t action, uint8_t step) {
+            begin('B');
+            field(button);
+            field(action);
+            field(step);
+            end();
+        }
+
+        static void outputs(uint8_t fanPower, uint8_t solderPower, uint8_t airFlow, uint8_t mode, uint8_t fanMode,
+                            uint8_t faults, bool standby, uint8_t profileState, uint8_t segment) {
+            begin('O');
+            field(fanPower);
+            field(solderPower);
+            field(airFlow);
+            field(mode);
+            field(fanMode);
+            field(faults);
+            field(standby);
+            field(profileState);
+            field(segment);
+            CAPTURE_PUT(',');
+            for(uint8_t i = 0; i < 3; i++) {
+                CAPTURE_PUT(Lcd::getChar(i));
+            }
+            field(Lcd::isBlinking());
+            end();
+        }
+};
+
+    #define CAPTURE_ZERO_CROSS(channel) Capture::zeroCrossISR(channel)
+#else
+    #define CAPTURE_ZERO_CROSS(channel)
+#endif
+
+#endif /* CAPTURE_H_ */
@@ -0,0 +1,34 @@
+#include <util/atomic.h>
+
+#include "clock.h"
+#include "shared.hpp"
+
+volatile uint32_t Clock::milliseconds = 0;
+
+void Clock::init() {
+    TCCR1A = 0; // normal mode, OC1A/OC1B disconnected
+    TCCR1B = (0 << CS12) | (1 << CS11) | (0 << CS10); // prescaler 1/8 = 1us per increment
+    OCR1B = TCNT1 + CLOCK_US_PER_TICK;
+    TIFR = (1 << OCF1B);
+    TIMSK |= (1 << OCIE1B); // Output Compare B Match Interrupt Enable
+}
+
+uint32_t Clock::millis() {
+    return atomicRead(milliseconds);
+}
+
+// The counts since the last tick boundary are added to the milliseconds. A compare that is
+// already due but whose ISR has not run yet shows up as more than CLOCK_US_PER_TICK counts,
+// so the result stays monotonic.
+uint32_t Clock::micros() {
+    uint32_t ms;
+    uint16_t now;
+    uint16_t next;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ms = milliseconds;
+        now = TCNT1;
+        next = OCR1B;
+    }
+    uint16_t elapsed = now - (next - CLOCK_US_PER_TICK);
+    return ms * CLOCK_US_PER_TICK + elapsed;
+}
@@ -0,0 +1,58 @@
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#include <avr/io.h>
+#include <stdint.h>
+
+const uint16_t CLOCK_US_PER_TICK = 1000;
+
+// Monotonic uptime. Timer1 runs free at 1 us per count and is never reloaded, compare B
+// fires every CLOCK_US_PER_TICK counts and is moved on by exactly that much, so the 1 ms
+// tick does not drift however late its ISR is entered. Compare A is left to PhaseAngle.
+// The 32 bit millisecond count wraps after 49 days, compare times as differences.
+class Clock {
+    private:
+        static volatile uint32_t milliseconds;
+
+    public:
+        static void init();
+
+        // From the compare B ISR, before anything that may enable interrupts
+        static inline void tickISR() {
+            OCR1B += CLOCK_US_PER_TICK;
+            milliseconds++;
+        }
+
+        static uint32_t millis();
+        static uint32_t micros();
+};
+
+// One-shot timeout on the uptime clock, running from start() until expire() sees it due
+class Deadline {
+    private:
+        uint32_t at;
+        bool running;
+
+    public:
+        Deadline() : at(0), running(false) {}
+
+        void start(uint32_t ms) {
+            at = Clock::millis() + ms;
+            running = true;
+        }
+
+        bool isRunning() const {
+            return running;
+        }
+
+        // Returns true once, when the deadline has passed
+        bool expire() {
+            if(!running || static_cast<int32_t>(Clock::millis() - at) < 0) {
+                return false;
+            }
+            running = false;
+            return true;
+        }
+};
+
+#endif /* CLOCK_H_ */
@@ -4,6 +4,8 @@
 #include "AVRPin.hpp"
 
 //#define SOFTUART 1
+//#define LATENCY_PROBE 1 // worst masked ISR sections, printed with SOFTUART
+//#define CAPTURE 1 // field trace of the control inputs and outputs over SOFTUART, see capture.hpp
 
 using FanLedPin = Pc5;
 using SolderLedPin = Pc0;
@@ -18,25 +20,96 @@ using LCDBPin = Pd7;
 using FanHeaterPin = Pd0;
 using SolderHeaterPin = Pd1;
 
+const uint8_t FAN_CHANNEL = 0;
+const uint8_t SOLDER_CHANNEL = 1;
+const uint8_t HEATER_CHANNELS = 2;
+
 const uint8_t FAN_THRESHOLD_TEMP = 50;
 const uint8_t FAN_HYSTERESIS_TEMP = 15;
-const uint8_t FAN_COOLING_TIMEOUT = 10; // second
+const uint8_t FAN_COOLING_TIMEOUT = 30; // second, blowing on below the threshold after a long full power session
+const uint8_t COOLING_SOAK_SHIFT = 9; // power history time constant, 2^9 * 100 ms = 51 s
+const uint8_t COOLING_FLOW_SPAN = 150; // degrees above the threshold for the full cooling air flow
 const uint8_t FAN_TEMP_ADC_CH = 7;
 const uint8_t FAN_AIR_ADC_CH = 2;
 const uint8_t SOLDER_TEMP_ADC_CH = 6;
 const uint8_t BUTTONS_ADC_CH = 4;
 
+// Temperature readings: 4^n oversampling for n extra bits, calibration points are stored in this scale
+const uint8_t ADC_OVERSAMPLING_BITS = 2; // 12 bit readings
+const uint8_t ADC_OVERSAMPLING_SAMPLES = 16; // conversions per reading, a multiple of 4^n and of 4 (whole fan PWM periods)
+const uint8_t ADC_CONVERSION_US = 104; // 13 ADC clocks at 8 MHz / 64
+const uint8_t ADC_SYNC_OFFSET = 3; // ms after the zero crossing, past the solder triac gate pulse
+const uint8_t ADC_WINDOWS_MAX = 4; // windows averaged into one reading while noisy, a power of 2
+const uint8_t ADC_NOISE_LOW = 2; // RMS in 12 bit LSBs, below it a reading takes fewer windows
+const uint8_t ADC_NOISE_HIGH = 6; // above it more
+const bool ADC_MEDIAN_FILTER = true; // median of three conversions against spikes
+const uint8_t ADC_IIR_SHIFT = 1; // low-pass over the readings, 0 = off
+
+// Percent of one heater at full power that may conduct in the same mains cycle, 100..200.
+// 200 lets both heaters fire together, lower it on shared supplies (see arbiter.h).
+const uint8_t POWER_PEAK_BUDGET = 200;
+
+// Element ratings for the energy reports
+const uint16_t FAN_HEATER_WATTS = 700;
+const uint16_t SOLDER_HEATER_WATTS = 60;
+const uint16_t METER_SAVE_PERIOD = 600; // s of heating between saves of the energy counters
+
 const uint8_t FAN_AIR_FLOW_MAX = 255; // pwm
 const uint8_t FAN_AIR_FLOW_MIN = 8;  // pwm
 const uint8_t LONG_PRESS_DELAY = 100; // 1 second
+const uint8_t BUTTONS_SAMPLE_PERIOD = 5; // ms
+const uint8_t BUTTONS_DEBOUNCE_DELAY = 15; // ms of a stable level before a change is accepted
+const uint16_t BUTTONS_REPEAT_DELAY = 400; // ms before a held up/down button starts repeating
+const uint8_t BUTTONS_REPEAT_PERIOD = 100; // ms
+const uint8_t BUTTONS_REPEAT_FAST_PERIOD = 50; // ms, after BUTTONS_REPEAT_FAST repeats
+const uint8_t BUTTONS_REPEAT_FAST = 10; // repeats before the period shortens and the step grows
+
+// Fan PID gains, the defaults of the runtime parameters
+const int16_t FAN_PID_KP = 40;  // 2.50 in 1/16
+const int16_t FAN_PID_KI = 1;   // 0.01 in 1/128
+const int16_t FAN_PID_KD = 240; // 15.00 in 1/16
+
+const uint8_t TIMER0_TICKS_PER_MS = 125; // 8 000 000 / 64 / 125 = 1 ms per LCD digit
 
 const uint16_t TEMPERATURE_MIN = 100;
 const uint16_t TEMPERATURE_MAX = 500;
 
 const uint16_t LCD_BLINK_DELAY = 500; // 500 ms
-const uint16_t CHANGE_MODE_DELAY = 300; // 3000 ms
+const uint16_t LCD_RENDER_PERIOD = 100; // ms, Lcd::render() call period
+const uint8_t LCD_BRIGHTNESS_MAX = 8;
+const uint8_t LCD_BRIGHTNESS_NORMAL = 8;
+const uint8_t LCD_BRIGHTNESS_STANDBY = 2;
+const uint16_t LCD_SCROLL_DELAY = 300; // ms per scrolled character
+const uint16_t LCD_FIELD_DELAY = 1500; // ms per field of a rotating status
+const uint16_t LCD_DIM_DELAY = 60000; // ms
+const uint16_t CHANGE_MODE_DELAY = 3000; // ms
+const uint16_t RECENTLY_CHANGED_DELAY = 20; // ms of steady digits after a change before blinking resumes
+
+// Fault detection, times in 100 ms control ticks
+const uint8_t FAULT_CONFIRM_TICKS = 3; // open/short readings in a row
+const uint8_t FAULT_RATE_TIME = 10;
+const uint16_t FAULT_RATE_MAX = 150; // degrees per FAULT_RATE_TIME at full power
+const uint16_t FAULT_RATE_SLACK = 30; // degrees per FAULT_RATE_TIME whatever the power
+const uint8_t FAULT_FULL_POWER = 90; // %
+const uint16_t FAULT_NO_RISE_TIME = 600; // at full power without FAULT_NO_RISE_TEMP of rise
+const uint16_t FAULT_NO_RISE_TEMP = 5;
+const uint16_t FAULT_NO_RISE_BAND = 2 * FAULT_NO_RISE_TEMP; // below the setpoint, closer a saturated loop is just loaded
+const uint16_t FAULT_RUNAWAY_SETTLE = 100; // without power before the rise is watched
+const uint16_t FAULT_RUNAWAY_TEMP = 30; // rise above the lowest temperature without power
+
+// Solder iron standby
+const uint16_t SOLDER_IDLE_TIMEOUT = 300; // s without a load signature
+const uint16_t SOLDER_STANDBY_TEMP = 200;
+const uint8_t SOLDER_SETTLE_BAND = 5; // degrees under the target before the signatures are watched
+const uint8_t SOLDER_LOAD_DROP = 3; // degrees within a second while heating
+const uint8_t SOLDER_LOAD_DIP = 10; // degrees under the target
+
+// Hot air profiles
+const uint8_t PROFILE_LOOKAHEAD = 3; // s the fan PID setpoint runs ahead of the ramp
+const uint8_t PROFILE_SETTLE_BAND = 5; // degrees from the target before its hold time starts
 
-const uint16_t COLD_CALIBRATION_TEMP = 150;
-const uint16_t HOT_CALIBRATION_TEMP = 250;
+const uint8_t SWEEP_SETTLE_BAND = 3; // degrees around the sweep setpoint
+const uint8_t SWEEP_SETTLE_TIME = 150; // 15 s in band before the point is taken
+const uint16_t CALIBRATION_MERGE_TEMP = 20; // a reference closer than this to a stored point replaces it
 
 #endif /* CONFIG_H_ */
@@ -0,0 +1,73 @@
+#include <avr/io.h>
+
+#include "cooling.h"
+#include "config.h"
+#include "params.h"
+#include "utils.h"
+
+uint16_t Cooling::soak = 0;
+uint16_t Cooling::lastTemp = 0;
+int8_t Cooling::rate = 0;
+uint8_t Cooling::rateTicks = 0;
+bool Cooling::active = false;
+bool Cooling::holding = false;
+uint8_t Cooling::share = 0;
+Deadline Cooling::hold;
+
+void Cooling::process(uint16_t temp, uint8_t power) {
+    // latched while cooling down without power, the cool-down is sized by the heat the
+    // element had when the heater went off, not by how long the cool-down has taken so far
+    if(power != 0 || !active) {
+        int32_t target = static_cast<int32_t>(power) << 8;
+        soak += (target - soak) >> COOLING_SOAK_SHIFT;
+    }
+
+    if(lastTemp == 0) {
+        lastTemp = temp;
+    }
+    if(++rateTicks >= 10) {
+        rateTicks = 0;
+        rate = clamp<int16_t>(lastTemp - temp, INT8_MIN, INT8_MAX);
+        lastTemp = temp;
+    }
+
+    uint16_t thresholdTemp = Params::get(PARAM_FAN_THRESHOLD);
+    if(temp > thresholdTemp + Params::get(PARAM_FAN_HYSTERESIS)) {
+        active = true;
+    }
+
+    // above the threshold by the excess temperature, but not below the residual heat share,
+    // below it while holding only by the residual heat
+    share = getResidualHeat();
+    if(temp > thresholdTemp) {
+        holding = false;
+        uint16_t excess = temp - thresholdTemp;
+        uint8_t excessShare = (excess >= COOLING_FLOW_SPAN) ? 100 : excess * 100 / COOLING_FLOW_SPAN;
+        if(excessShare > share) {
+            share = excessShare;
+        }
+        return;
+    }
+
+    if(active && !holding) {
+        holding = true;
+        hold.start(static_cast<uint32_t>(Params::get(PARAM_FAN_COOLING_TIMEOUT)) * 1000 * getResidualHeat() / 100);
+    }
+
+    hold.expire();
+    if(!hold.isRunning() && rate >= 0) {
+        active = false;
+    }
+}
+
+bool Cooling::isActive() {
+    return active;
+}
+
+uint8_t Cooling::getResidualHeat() {
+    return soak >> 8;
+}
+
+uint8_t Cooling::getAirFlow() {
+    return map(share, 0, 100, Params::get(PARAM_FAN_AIR_FLOW_MIN), Params::get(PARAM_FAN_AIR_FLOW_MAX));
+}
@@ -0,0 +1,33 @@
+#ifndef COOLING_H_
+#define COOLING_H_
+
+#include <stdint.h>
+
+#include "clock.h"
+
+// Cool-down of the hot air gun. The heat left in the element is estimated from the power
+// history, a slow average of the heater power that is held while the gun cools down. It sets
+// how hard the air blows on the way down and how long it keeps blowing once the threshold is
+// reached, up to the cooling timeout parameter after a long session at full power. The
+// measured cooling rate ends the cooling only once the sensor has stopped rising again from
+// the heat soaked into the element.
+class Cooling {
+    private:
+        static uint16_t soak;      // percent of power, 8 fraction bits
+        static uint16_t lastTemp;  // a second ago
+        static int8_t rate;        // degrees per second, positive while cooling down
+        static uint8_t rateTicks;
+        static bool active;
+        static bool holding;
+        static uint8_t share;      // % of the air flow range
+        static Deadline hold;
+
+    public:
+        // Every 100 ms with the reading and the power applied since the previous call
+        static void process(uint16_t temp, uint8_t power);
+        static bool isActive();
+        static uint8_t getResidualHeat(); // %
+        static uint8_t getAirFlow();      // pwm
+};
+
+#endif /* COOLING_H_ */
@@ -0,0 +1,73 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "eepromwriter.h"
+#include "events.h"
+
+EepromWriter::Request EepromWriter::queue[EEPROM_QUEUE_SIZE];
+volatile uint8_t EepromWriter::count = 0;
+volatile uint8_t EepromWriter::index = 0;
+
+// EE_RDY stays pending while the EEPROM is idle, so handling one byte per call
+// keeps the interrupt short and lets other interrupts in between
+void EepromWriter::ReadyISR() {
+    if(count == 0) {
+        EECR &= ~(1 << EERIE);
+        Events::post(EVENT_STORAGE);
+        return;
+    }
+
+    const Request &request = queue[0];
+    if(index < request.size) {
+        EEAR = reinterpret_cast<uintptr_t>(request.eeprom + index);
+        uint8_t value = request.ram[index];
+        index++;
+
+        EECR |= 1 << EERE;
+        if(EEDR != value) {
+            EEDR = value;
+            EECR |= 1 << EEMWE;
+            EECR |= 1 << EEWE;
+        }
+        return;
+    }
+
+    count--;
+    for(uint8_t i = 0; i < count; i++) {
+        queue[i] = queue[i + 1];
+    }
+    index = 0;
+}
+
+ISR(EE_RDY_vect) {
+    EepromWriter::ReadyISR();
+}
+
+bool EepromWriter::update(const void *ram, void *eeprom, uint8_t size) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        for(uint8_t i = 0; i < count; i++) {
+            if(queue[i].ram == ram && queue[i].eeprom == eeprom) {
+                if(i == 0) {
+                    index = 0; // block is being written, rescan from the start
+                }
+                return true;
+            }
+        }
+
+        if(count == EEPROM_QUEUE_SIZE) {
+            return false;
+        }
+
+        queue[count].ram = static_cast<const uint8_t *>(ram);
+        queue[count].eeprom = static_cast<uint8_t *>(eeprom);
+        queue[count].size = size;
+        count++;
+        EECR |= 1 << EERIE;
+    }
+    return true;
+}
+
+bool EepromWriter::isReady() {
+    return count == 0;
+}
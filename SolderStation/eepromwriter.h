@@ -0,0 +1,29 @@
+#ifndef EEPROMWRITER_H_
+#define EEPROMWRITER_H_
+
+#include <stdint.h>
+
+const uint8_t EEPROM_QUEUE_SIZE = 4;
+
+// Background EEPROM update driven by the EE_RDY interrupt.
+// The RAM block is copied byte by byte, only bytes that differ are written, one per interrupt.
+// The RAM block must stay valid until isReady(), changes made meanwhile are picked up.
+class EepromWriter {
+    private:
+        typedef struct {
+            const uint8_t *ram;
+            uint8_t *eeprom;
+            uint8_t size;
+        } Request;
+
+        static Request queue[EEPROM_QUEUE_SIZE];
+        static volatile uint8_t count;
+        static volatile uint8_t index;
+
+    public:
+        static bool update(const void *ram, void *eeprom, uint8_t size);
+        static bool isReady();
+        static void ReadyISR();
+};
+
+#endif /* EEPROMWRITER_H_ */
@@ -0,0 +1,45 @@
+#include <util/atomic.h>
+
+#include "events.h"
+
+Events::Subscription Events::subscriptions[MAX_SUBSCRIPTIONS];
+uint8_t Events::subscriptionsCount = 0;
+volatile uint8_t Events::pending = 0;
+volatile bool Events::scheduled = false;
+
+bool Events::subscribe(uint8_t events, TaskPointer handler) {
+    if(subscriptionsCount == MAX_SUBSCRIPTIONS) {
+        return false;
+    }
+
+    subscriptions[subscriptionsCount].events = events;
+    subscriptions[subscriptionsCount].handler = handler;
+    subscriptionsCount++;
+    return true;
+}
+
+// A full task queue leaves the events pending, the next post tries to queue the dispatch again
+void Events::post(uint8_t events) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        pending |= events;
+        if(!scheduled) {
+            scheduled = Scheduler::setTask(dispatch);
+        }
+    }
+}
+
+// Handlers run in subscription order, each at most once per dispatch
+void Events::dispatch() {
+    uint8_t events;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        events = pending;
+        pending = 0;
+        scheduled = false;
+    }
+
+    for(uint8_t i = 0; i < subscriptionsCount; i++) {
+        if(subscriptions[i].events & events) {
+            subscriptions[i].handler();
+        }
+    }
+}
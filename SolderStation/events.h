@@ -0,0 +1,42 @@
+#ifndef EVENTS_H_
+#define EVENTS_H_
+
+#include <stdint.h>
+
+#include "Scheduler.h"
+
+const uint8_t MAX_SUBSCRIPTIONS = 8;
+
+enum Event {
+    EVENT_SWITCH   = 1 << 0, // heater power switch turned on/off
+    EVENT_SEAT     = 1 << 1, // hot air gun taken from/put on the seat
+    EVENT_BUTTON   = 1 << 2, // mode changing click or hold
+    EVENT_SETPOINT = 1 << 3, // value changed by the up/down buttons
+    EVENT_SENSOR   = 1 << 4, // measured temperature changed
+    EVENT_DISPLAY  = 1 << 5, // display timeout expired or status field rotated
+    EVENT_SETTINGS = 1 << 6, // settings or counters to be saved
+    EVENT_STORAGE  = 1 << 7  // background EEPROM writer is idle
+};
+
+// Static publish/subscribe bus. Events are collected in a bit set, so posting is cheap
+// and ISR safe, the handlers run later from a single scheduler task.
+class Events {
+    private:
+        typedef struct {
+            uint8_t events;
+            TaskPointer handler;
+        } Subscription;
+
+        static Subscription subscriptions[MAX_SUBSCRIPTIONS];
+        static uint8_t subscriptionsCount;
+        static volatile uint8_t pending;
+        static volatile bool scheduled;  // dispatch is in the task queue
+
+        static void dispatch();
+
+    public:
+        static bool subscribe(uint8_t events, TaskPointer handler);
+        static void post(uint8_t events);
+};
+
+#endif /* EVENTS_H_ */
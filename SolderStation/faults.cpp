@@ -0,0 +1,112 @@
+#include <avr/io.h>
+#include <stdlib.h>
+
+#include "faults.h"
+#include "events.h"
+
+#ifdef SOFTUART
+    #include "softuart.hpp"
+#endif
+
+const uint16_t FAULT_ADC_OPEN = 1020 << ADC_OVERSAMPLING_BITS;
+const uint16_t FAULT_ADC_SHORT = 4 << ADC_OVERSAMPLING_BITS;
+
+Faults::State Faults::states[HEATER_CHANNELS];
+
+// Called every 100 ms with the latest reading, and the power applied since the previous call
+// with the setpoint it was applied for
+Fault Faults::check(uint8_t channel, uint16_t adc, uint16_t temp, uint16_t setpoint, uint8_t power, bool switchOn) {
+    State &state = states[channel];
+    if(state.code != FAULT_NONE) {
+        return static_cast<Fault>(state.code);
+    }
+
+    Fault fault = detect(state, adc, temp, setpoint, power, switchOn);
+    if(fault != FAULT_NONE) {
+        state.code = fault;
+        Events::post(EVENT_DISPLAY);
+#ifdef SOFTUART
+        Softuart::sendString("F,");
+        Softuart::sendValue(channel);
+        Softuart::sendChar(',');
+        Softuart::sendValue(fault);
+        Softuart::sendString("\r\n");
+#endif
+    }
+    return fault;
+}
+
+Fault Faults::detect(State &state, uint16_t adc, uint16_t temp, uint16_t setpoint, uint8_t power, bool switchOn) {
+    if(adc >= FAULT_ADC_OPEN || adc <= FAULT_ADC_SHORT) {
+        // a detached or switched off iron reads open as well, only a heater in use is at fault
+        if(switchOn && ++state.suspect >= FAULT_CONFIRM_TICKS) {
+            return (adc >= FAULT_ADC_OPEN) ? FAULT_OPEN : FAULT_SHORT;
+        }
+        if(!switchOn) {
+            state.suspect = 0;
+        }
+        return FAULT_NONE; // the other checks need a valid temperature
+    }
+    state.suspect = 0;
+
+    // The change over FAULT_RATE_TIME against the power applied meanwhile and in the window
+    // before (the element lags): a rise needs power, a fall needs the power to be off, by up
+    // to FAULT_RATE_MAX at full power; FAULT_RATE_SLACK either way for load and heat spread.
+    if(state.rateTicks == 0) {
+        state.rateTemp = temp;
+        state.rateEnergy = 0;
+    }
+    state.rateEnergy += power;
+    if(++state.rateTicks >= FAULT_RATE_TIME) {
+        state.rateTicks = 0;
+        uint8_t average = state.rateEnergy / FAULT_RATE_TIME;
+        uint8_t most = (average > state.ratePower) ? average : state.ratePower;
+        uint8_t least = (average < state.ratePower) ? average : state.ratePower;
+        state.ratePower = average;
+
+        uint16_t maxRise = FAULT_RATE_SLACK + static_cast<uint32_t>(FAULT_RATE_MAX) * most / 100;
+        uint16_t maxFall = FAULT_RATE_SLACK + static_cast<uint32_t>(FAULT_RATE_MAX) * (100 - least) / 100;
+        if(temp > state.rateTemp + maxRise || temp + maxFall < state.rateTemp) {
+            return FAULT_RATE;
+        }
+    }
+
+    // only far below the setpoint, the bang-bang solder loop and a saturated fan loop run at
+    // full power for long under a heavy load while the reading stays close to it
+    if(power >= FAULT_FULL_POWER && temp + FAULT_NO_RISE_BAND < setpoint) {
+        if(state.riseTicks == 0 || temp >= state.riseTemp + FAULT_NO_RISE_TEMP) {
+            state.riseTicks = 0; // heating up, measure the next step
+            state.riseTemp = temp;
+        }
+        if(++state.riseTicks > FAULT_NO_RISE_TIME) {
+            return FAULT_NO_RISE;
+        }
+    } else {
+        state.riseTicks = 0;
+    }
+
+    if(power == 0) {
+        if(state.idleTicks < FAULT_RUNAWAY_SETTLE) {
+            state.idleTicks++; // let the heat stored in the heater spread first
+            state.idleMinTemp = temp;
+        }
+        if(temp < state.idleMinTemp) {
+            state.idleMinTemp = temp;
+        }
+        if(temp > state.idleMinTemp + FAULT_RUNAWAY_TEMP) {
+            return FAULT_RUNAWAY;
+        }
+    } else {
+        state.idleTicks = 0;
+    }
+
+    return FAULT_NONE;
+}
+
+Fault Faults::get(uint8_t channel) {
+    return static_cast<Fault>(states[channel].code);
+}
+
+void Faults::clear(uint8_t channel) {
+    states[channel] = State();
+}
@@ -0,0 +1,45 @@
+#ifndef FAULTS_H_
+#define FAULTS_H_
+
+#include <stdint.h>
+
+#include "config.h"
+
+enum Fault {
+    FAULT_NONE = 0,
+    FAULT_OPEN,     // sensor disconnected, the amplifier saturates
+    FAULT_SHORT,    // sensor shorted to ground
+    FAULT_RATE,     // temperature changes faster than the applied power explains
+    FAULT_NO_RISE,  // full power without heating up, sensor detached from the heater
+    FAULT_RUNAWAY,  // heating up without power, stuck triac
+    FAULTS_COUNT
+};
+
+// Plausibility checks on the readings the control loops already took. A fault is latched
+// until the heater is switched on again, the control loops keep the heater off meanwhile.
+class Faults {
+    private:
+        typedef struct {
+            uint8_t code;
+            uint8_t suspect;       // consecutive out of range readings
+            uint8_t rateTicks;
+            uint16_t rateTemp;     // temperature FAULT_RATE_TIME ago
+            uint16_t rateEnergy;   // power summed since then
+            uint8_t ratePower;     // average power of the window before
+            uint16_t riseTicks;    // at full power far below the setpoint
+            uint16_t riseTemp;     // temperature when full power began or last rose
+            uint16_t idleTicks;    // without power
+            uint16_t idleMinTemp;
+        } State;
+
+        static State states[HEATER_CHANNELS];
+
+        static Fault detect(State &state, uint16_t adc, uint16_t temp, uint16_t setpoint, uint8_t power, bool switchOn);
+
+    public:
+        static Fault check(uint8_t channel, uint16_t adc, uint16_t temp, uint16_t setpoint, uint8_t power, bool switchOn);
+        static Fault get(uint8_t channel);
+        static void clear(uint8_t channel);
+};
+
+#endif /* FAULTS_H_ */
@@ -0,0 +1,183 @@
+#ifndef HEATER_H_
+#define HEATER_H_
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "Scheduler.h"
+#include "calibrator.h"
+#include "sampler.h"
+#include "arbiter.h"
+#include "meter.h"
+#include "capture.hpp"
+
+const uint8_t ON_OFF_DELAY = 3;
+const uint8_t POWER_STEPS = 100; // number of power levels = 100%
+
+extern const uint16_t PFC_delay[POWER_STEPS + 1] PROGMEM;
+
+// Zero-crossing sources
+class ExtInt0 {
+    public:
+        static void init() {
+            MCUCR |= (1 << ISC01) | (1 << ISC00); // The rising edge of INT0 generates an interrupt request
+            GICR |= (1 << INT0); // Turns on INT0
+        }
+};
+
+class ExtInt1 {
+    public:
+        static void init() {
+            MCUCR |= (1 << ISC11) | (1 << ISC10); // The rising edge of INT1 generates an interrupt request
+            GICR |= (1 << INT1); // Turns on INT1
+        }
+};
+
+// Phase-fired control (PFC), also called phase cutting or "phase angle control"
+// Uses compare A of the free running Timer1 (see clock.h), so only one channel can use it
+template <class Pin>
+class PhaseAngle {
+    private:
+        static bool pinNeedSet;
+
+        static inline void timerStart(uint16_t delay_us) {
+            OCR1A = TCNT1 + delay_us;
+            TIFR = (1 << OCF1A); // a stale match of the previous half-cycle
+            TIMSK |= (1 << OCIE1A); // Output Compare A Match Interrupt Enable
+        }
+
+        static inline void timerStop() {
+            TIMSK &= ~(1 << OCIE1A);
+        }
+
+    public:
+        static void init() {}
+
+        static inline uint16_t firingDelay(uint8_t power) {
+            return (power == 0) ? SAMPLER_NO_FIRING : pgm_read_word(&PFC_delay[power]);
+        }
+
+        static inline void zeroCross(uint8_t power) {
+            if (power == 0) {
+                pinNeedSet = false;
+                Pin::Clear();
+                return;
+            }
+
+            pinNeedSet = true;
+            timerStart(pgm_read_word(&PFC_delay[power]));
+        }
+
+        static inline void timerISR() {
+            if(pinNeedSet) {
+                Pin::Set();
+                pinNeedSet = false;
+                OCR1A += 100; // gate pulse, from the match rather than from the ISR entry
+            } else {
+                Pin::Clear();
+                timerStop();
+            }
+        }
+};
+
+template <class Pin> bool PhaseAngle<Pin>::pinNeedSet = false;
+
+// Bresenham's line algorithm + Pulse skipping modulation (PSM)
+// Behind the PowerArbiter it is granted whole cycles only, 0 or 100, and fires them as given
+template <class Pin>
+class PulseSkip {
+    private:
+        static int8_t error;
+
+    public:
+        static void init() {}
+
+        static inline uint16_t firingDelay(uint8_t power) {
+            return (power == 0) ? SAMPLER_NO_FIRING : 0; // at the crossing, if at all
+        }
+
+        static inline void zeroCross(uint8_t power) {
+            error -= power;
+            if(error < 0) {
+                error += POWER_STEPS;
+                Pin::Set();
+                Scheduler::setTimer([]{ Pin::Clear(); }, 2);
+            }
+        }
+};
+
+template <class Pin> int8_t PulseSkip<Pin>::error = 0;
+
+// One heater: zero-crossing presence (power switch), temperature sensing and calibration, power output.
+// The zero-crossing ISR of the source has to call zeroCrossISR().
+template <uint8_t ID, class HeaterPin, uint8_t ADC_CHANNEL, class ZeroCross, template <class> class Modulation>
+class HeaterChannel {
+    private:
+        static volatile uint8_t counter;  // set by the zero-crossing ISR
+        static bool switchOn;
+
+    public:
+        typedef Modulation<HeaterPin> Modulator;
+        enum { Id = ID };
+
+        static void init() {
+            HeaterPin::Clear();
+            HeaterPin::SetDirWrite();
+            Modulator::init();
+            ZeroCross::init();
+            Sampler::setChannel(ID, ADC_CHANNEL);
+        }
+
+        static inline void zeroCrossISR() {
+            counter = ON_OFF_DELAY;
+            CAPTURE_ZERO_CROSS(ID);
+            uint8_t power = PowerArbiter::grantISR(ID);
+            Meter::countISR(ID, power);
+            Modulator::zeroCross(power);
+            Sampler::zeroCrossISR(Modulator::firingDelay(power));
+        }
+
+        // Called every 10 ms, the switch is on while zero crossings arrive
+        // Returns true when the switch state has changed
+        static bool updateSwitch() {
+            bool oldSwitchOn = switchOn;
+            switchOn = counter > 0;
+            if(switchOn) {
+                counter--;
+            }
+            return switchOn != oldSwitchOn;
+        }
+
+        static bool isSwitchOn() {
+            return switchOn;
+        }
+
+        // Requested power, the arbiter grants it cycle by cycle
+        static void setPower(uint8_t power_percentage) {
+            PowerArbiter::request(ID, power_percentage);
+            if(power_percentage == 0) {
+                HeaterPin::Clear();
+            }
+        }
+
+        static uint8_t getPower() {
+            return PowerArbiter::getRequest(ID);
+        }
+
+        // Latest background reading with ADC_OVERSAMPLING_BITS fraction bits
+        static uint16_t getAverageAdc() {
+            return Sampler::get(ID);
+        }
+
+        static uint16_t getTemp() {
+            return Calibrator::convertTemp(ID, getAverageAdc());
+        }
+};
+
+template <uint8_t ID, class HeaterPin, uint8_t ADC_CHANNEL, class ZeroCross, template <class> class Modulation>
+volatile uint8_t HeaterChannel<ID, HeaterPin, ADC_CHANNEL, ZeroCross, Modulation>::counter = 0;
+
+template <uint8_t ID, class HeaterPin, uint8_t ADC_CHANNEL, class ZeroCross, template <class> class Modulation>
+bool HeaterChannel<ID, HeaterPin, ADC_CHANNEL, ZeroCross, Modulation>::switchOn = false;
+
+#endif /* HEATER_H_ */
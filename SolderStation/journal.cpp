@@ -0,0 +1,81 @@
+#include <string.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+#include "journal.h"
+#include "eepromwriter.h"
+
+Journal::Journal(void *eepromStart, uint8_t slotSize, uint8_t slots)
+    : eeprom(static_cast<uint8_t *>(eepromStart)), slotSize(slotSize), slots(slots), head(slots - 1) {
+    header.sequence = 0;
+}
+
+uint8_t *Journal::slot(uint8_t index) const {
+    return eeprom + index * slotSize;
+}
+
+uint16_t Journal::crc(const Header &record, const uint8_t *payload, bool fromEeprom) const {
+    uint16_t crc = 0xffff;
+    crc = _crc16_update(crc, record.sequence);
+    crc = _crc16_update(crc, record.version);
+    crc = _crc16_update(crc, record.size);
+    for(uint8_t i = 0; i < record.size; i++) {
+        crc = _crc16_update(crc, fromEeprom ? eeprom_read_byte(payload + i) : payload[i]);
+    }
+    return crc;
+}
+
+// Single forward scan for the newest valid record, returns its version or 0 if there is none.
+// The payload buffer is zero filled past the stored size, migration is up to the caller.
+uint8_t Journal::load(void *payload, uint8_t size, uint8_t *storedSize) {
+    bool found = false;
+    Header newest;
+
+    for(uint8_t i = 0; i < slots; i++) {
+        Header record;
+        eeprom_read_block(&record, slot(i), sizeof(record));
+        if(record.version == 0 || record.size > slotSize - sizeof(Header) ||
+           record.crc != crc(record, slot(i) + sizeof(Header), true)) {
+            continue;
+        }
+
+        if(!found || static_cast<int8_t>(record.sequence - newest.sequence) > 0) {
+            found = true;
+            newest = record;
+            head = i;
+        }
+    }
+
+    memset(payload, 0, size);
+    if(storedSize) {
+        *storedSize = found ? newest.size : 0;
+    }
+
+    if(!found) {
+        return 0;
+    }
+
+    header.sequence = newest.sequence;
+    eeprom_read_block(payload, slot(head) + sizeof(Header), newest.size < size ? newest.size : size);
+    return newest.version;
+}
+
+// Queues the record for the background writer, fails while the previous one is still being written
+bool Journal::save(const void *payload, uint8_t size, uint8_t version) {
+    if(!EepromWriter::isReady() || size > slotSize - sizeof(Header)) {
+        return false;
+    }
+
+    if(++head == slots) {
+        head = 0;
+    }
+
+    header.sequence++;
+    header.version = version;
+    header.size = size;
+    header.crc = crc(header, static_cast<const uint8_t *>(payload), false);
+
+    EepromWriter::update(payload, slot(head) + sizeof(Header), size);
+    EepromWriter::update(&header, slot(head), sizeof(Header));
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <stdint.h>
+
+// Log-structured EEPROM store. Every save goes to the next slot of a ring, so writes are
+// spread over the whole region. The payload is written first and the CRC protected header
+// last, a record cut by a reset is skipped and the previous one is loaded instead.
+class Journal {
+    private:
+        typedef struct {
+            uint8_t sequence;
+            uint8_t version;
+            uint8_t size;
+            uint16_t crc;
+        } Header;
+
+        uint8_t *const eeprom;
+        const uint8_t slotSize;
+        const uint8_t slots;
+        uint8_t head;
+        Header header; // must live until the background writer is done
+
+        uint8_t *slot(uint8_t index) const;
+        uint16_t crc(const Header &record, const uint8_t *payload, bool fromEeprom) const;
+
+    public:
+        enum { HeaderSize = sizeof(Header) };
+
+        Journal(void *eepromStart, uint8_t slotSize, uint8_t slots);
+        uint8_t load(void *payload, uint8_t size, uint8_t *storedSize = nullptr);
+        bool save(const void *payload, uint8_t size, uint8_t version);
+
+        // The EEPROM region of all the slots
+        uint8_t *getStart() const {
+            return eeprom;
+        }
+
+        uint16_t getLength() const {
+            return static_cast<uint16_t>(slotSize) * slots;
+        }
+};
+
+#endif /* JOURNAL_H_ */
@@ -0,0 +1,60 @@
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <avr/io.h>
+
+// Interrupt latency budget, 8 MHz, 1 cycle = 125 ns
+//
+// Nothing preempts on AVR unless a handler enables interrupts itself, so the entry latency
+// of INT0/INT1/TIMER1_COMPA is the longest section that runs with interrupts disabled plus
+// the other of the two zero-crossing handlers, they arrive on the same mains edge.
+//
+//   hardware entry, vector jump, prologue          ~ 15 cycles    2 us
+//   TIMER0_OVF (reload, LCD ports)                 ~ 50 cycles    6 us
+//   TIMER1_COMPB masked part (clock)               ~ 30 cycles    4 us
+//   ADC_vect per conversion (median, sums)         ~120 cycles   15 us
+//   INT0 / INT1 (arbiter, modulator, sampler sync) ~180 cycles   23 us
+//   TIMER1_COMPA, EE_RDY                           ~ 50 cycles    6 us
+//   ATOMIC_BLOCKs of the main loop (queues)        ~100 cycles   13 us
+//   Softuart::sendChar, SOFTUART builds only       ~170 cycles   21 us
+//
+//   worst case INT1 entry: ADC conversion + INT0 + entry      ~ 40 us
+//
+// 40 us of a 10 ms half-cycle move the fan phase angle by 0.7 degree. The 1 ms tick
+// work (scheduler, sampler and button state machines) and the ADC window statistics run
+// with interrupts enabled and do not count.
+//
+// With LATENCY_PROBE defined the masked parts of the main handlers record their worst
+// duration in cycles, read from the free running airflow PWM timer. It wraps after
+// 256 cycles, so longer sections would show up too short, which is over the budget anyway.
+
+#ifdef LATENCY_PROBE
+enum LatencySource { LATENCY_TICK, LATENCY_LCD, LATENCY_ADC, LATENCY_ZERO_CROSS, LATENCY_SOURCES };
+
+class Latency {
+    public:
+        static volatile uint8_t *worst() {
+            static volatile uint8_t cycles[LATENCY_SOURCES];
+            return cycles;
+        }
+
+        static inline uint8_t start() {
+            return TCNT2;
+        }
+
+        static inline void stop(LatencySource source, uint8_t start) {
+            uint8_t cycles = TCNT2 - start;
+            if(cycles > worst()[source]) {
+                worst()[source] = cycles;
+            }
+        }
+};
+
+    #define LATENCY_START() uint8_t latencyStart = Latency::start()
+    #define LATENCY_STOP(source) Latency::stop(source, latencyStart)
+#else
+    #define LATENCY_START()
+    #define LATENCY_STOP(source)
+#endif
+
+#endif /* LATENCY_H_ */
@@ -1,9 +1,28 @@
+#include <avr/pgmspace.h>
+
 #include "lcd.h"
 #include "config.h"
 #include "utils.h"
 
-static const uint8_t didgits[] = {
-  //__fagcbhde
+// 7-segment font for ASCII ' '..'_', lowercase letters are shown as uppercase
+static const uint8_t font[] PROGMEM = {
+  //fagcbhde
+    0b00000000, // [ ]
+    0b00011100, // !
+    0b10001000, // "
+    0b10111011, // #
+    0b11110010, // $
+    0b00101101, // %
+    0b00111000, // &
+    0b10000000, // '
+    0b11000010, // (
+    0b01001010, // )
+    0b11000000, // *
+    0b10100001, // +
+    0b00000001, // ,
+    0b00100000, // -
+    0b00000100, // .
+    0b00101001, // /
     0b11011011, // 0
     0b00011000, // 1
     0b01101011, // 2
@@ -14,48 +33,111 @@ static const uint8_t didgits[] = {
     0b01011000, // 7
     0b11111011, // 8
     0b11111010, // 9
+    0b01000010, // :
+    0b01010010, // ;
+    0b11100000, // <
+    0b00100010, // =
+    0b01101000, // >
+    0b01101101, // ?
+    0b01111011, // @
+    0b11111001, // A
+    0b10110011, // B
+    0b11000011, // C
+    0b00111011, // D
+    0b11100011, // E
+    0b11100001, // F
+    0b11010011, // G
+    0b10111001, // H
+    0b10000001, // I
+    0b00011011, // J
+    0b11110001, // K
+    0b10000011, // L
+    0b01010001, // M
+    0b11011001, // N
+    0b11011011, // O
+    0b11101001, // P
+    0b11101010, // Q
+    0b11001001, // R
+    0b11110010, // S
+    0b10100011, // T
+    0b10011011, // U
+    0b10011011, // V
+    0b10001010, // W
+    0b10111001, // X
+    0b10111010, // Y
+    0b01101011, // Z
+    0b11000011, // [
+    0b10110000, // backslash
+    0b01011010, // ]
+    0b11001000, // ^
+    0b00000010, // _
 };
 
-enum Chars {
-       // fagcbhde       
-    A = 0b11111001, // A
-    B = 0b10110011, // B
-    C = 0b11000011, // C
-    D = 0b00111011, // D
-    E = 0b11100011, // E
-    F = 0b11100001, // F
-    L = 0b10000011, // L
-    P = 0b11101001, // P
-    Dash =  0b00100000, // -
-    Dot =   0b00000100, // dot
-    Space = 0b00000000  // [ ]
+const uint8_t FONT_FIRST_CHAR = ' ';
+const uint8_t FONT_LAST_CHAR = '_';
+const uint8_t LCD_DOT = 0b00000100;
+const uint8_t LCD_SCROLL_STEPS = LCD_SCROLL_DELAY / LCD_RENDER_PERIOD;
+const uint8_t LCD_FIELD_STEPS = LCD_FIELD_DELAY / LCD_RENDER_PERIOD;
+
+const uint8_t LCD_ANODES_MASK = (1 << LCDAnode1Pin::Number) | (1 << LCDAnode2Pin::Number) | (1 << LCDAnode3Pin::Number);
+const uint8_t LCD_PORTD_MASK = LCD_ANODES_MASK | (1 << LCDBPin::Number);
+const uint8_t LCD_ANODES[] = {1 << LCDAnode1Pin::Number, 1 << LCDAnode2Pin::Number, 1 << LCDAnode3Pin::Number};
+
+// Digit on-time in timer0 ticks (8 us) per brightness level, roughly perceptually even.
+// At least LCD_BLANK_TICKS of every 1 ms slot stay dark so the anode transistors switch off
+// before the next digit's segments are applied (ghosting).
+const uint8_t LCD_BLANK_TICKS = 10;
+const uint8_t LCD_BRIGHTNESS_TICKS[LCD_BRIGHTNESS_MAX + 1] PROGMEM = {
+    4, 6, 9, 14, 21, 33, 50, 77, TIMER0_TICKS_PER_MS - LCD_BLANK_TICKS
 };
 
-uint8_t chars[3];
+Lcd::Digit Lcd::frames[2][3];
+volatile uint8_t Lcd::front = 0;
+volatile uint8_t Lcd::lightTicks = TIMER0_TICKS_PER_MS - LCD_BLANK_TICKS;
+
+char value[3];            // text shown when there is no message
+const char *message;      // PROGMEM text, scrolls if longer than the display
+uint8_t messageLength;
+uint8_t scroll = 0;
+uint8_t field = 0;
 bool blink = false;
 
-void Lcd::draw() {
-    LCDAnode1Pin::Clear();
-    LCDAnode2Pin::Clear();
-    LCDAnode3Pin::Clear();
+uint8_t glyph(char ch) {
+    if(ch >= 'a' && ch <= 'z') {
+        ch -= 'a' - 'A';
+    }
 
-    static uint16_t delay;
-    if(delay >= LCD_BLINK_DELAY * 2 || !blink) {
-        delay = 0;
+    if(ch < FONT_FIRST_CHAR || ch > FONT_LAST_CHAR) {
+        return 0;
+    }
+
+    return pgm_read_byte(&font[ch - FONT_FIRST_CHAR]);
+}
+
+char Lcd::getChar(uint8_t index) {
+    if(!message) {
+        return value[index];
     }
-    delay++;
 
-    if(delay > LCD_BLINK_DELAY) return; // turn off lcd
+    index += scroll;
+    return (index < messageLength) ? pgm_read_byte(&message[index]) : ' ';
+}
 
+// Called from the 1 ms timer ISR, only outputs the bytes prepared by render()
+// Returns the number of timer ticks the digit should stay lit
+uint8_t Lcd::draw() {
     static uint8_t charIndex = 0;
-    char heat_led = ((FanHeaterPin::IsSet() | SolderHeaterPin::IsSet()) && charIndex == 2)
-                    ? Chars::Dot
-                    : Chars::Space;
+    static uint8_t shown = 0;
+
+    if(charIndex == 0) {
+        shown = front; // switch frames between scans only
+    }
 
-    uint8_t ch = ~(chars[charIndex] | heat_led);
+    const Digit &digit = frames[shown][charIndex];
+    uint8_t segments = digit.segments;
 
     #ifdef SOFTUART
-        ch |= (PORTB & (1 << PORTB5)); // block pb5 pin change because its used by soft uart
+        segments |= (PORTB & (1 << PORTB5)); // block pb5 pin change because its used by soft uart
     #endif
 
     /*
@@ -63,56 +145,95 @@ void Lcd::draw() {
     The general I/O port function is overridden by the Output Compare (OC2) from the waveform generator if
     either of the COM21:0 bits are set.
     */
-    Portb::Write(ch); 
-    LCDBPin::Set(ch & (1 << 3)); // set B pin if corresponding bit is set
-    
-    switch(charIndex) {
-        case 0: LCDAnode1Pin::Set();
-        break;
-        case 1: LCDAnode2Pin::Set();
-        break;
-        case 2: LCDAnode3Pin::Set();
-        break;
-    }
+    Portb::Write(segments);
+    LCDAnode1Pin::Port::ClearAndSet(LCD_PORTD_MASK, digit.anodes);
 
     if(++charIndex > 2) {
         charIndex = 0;
     }
+
+    return lightTicks;
 }
 
-void Lcd::setOFF() {
-    chars[0] = didgits[0];
-    chars[1] = Chars::F;
-    chars[2] = Chars::F;
+// Called from the timer ISR at the end of the lit phase
+void Lcd::blank() {
+    LCDAnode1Pin::Port::Clear(LCD_ANODES_MASK);
 }
 
-void Lcd::setSleep() {
-    chars[0] = didgits[5];
-    chars[1] = Chars::L;
-    chars[2] = Chars::P;
+void Lcd::setBrightness(uint8_t level) {
+    lightTicks = pgm_read_byte(&LCD_BRIGHTNESS_TICKS[clamp(level, (uint8_t)0, LCD_BRIGHTNESS_MAX)]);
 }
 
-void Lcd::setSensorError() {
-    chars[0] = didgits[5];
-    chars[1] = Chars::Dash;
-    chars[2] = Chars::E;
+// Called from the main loop every 100 ms, prepares the back frame and publishes it.
+// Returns true when the rotation has moved to the next field.
+bool Lcd::render(bool heat) {
+    static uint16_t delay;
+    if(delay >= LCD_BLINK_DELAY * 2 || !blink) {
+        delay = 0;
+    }
+    delay += LCD_RENDER_PERIOD;
+    bool visible = delay <= LCD_BLINK_DELAY;
+
+    static uint8_t scrollDelay = 0;
+    if(++scrollDelay >= LCD_SCROLL_STEPS) {
+        scrollDelay = 0;
+        if(message && messageLength > 3 && ++scroll > messageLength) { // scroll out, then restart
+            scroll = 0;
+        }
+    }
+
+    static uint8_t fieldDelay = 0;
+    bool nextField = ++fieldDelay >= LCD_FIELD_STEPS;
+    if(nextField) {
+        fieldDelay = 0;
+        field++;
+    }
+
+    Digit *frame = frames[front ^ 1];
+    for(uint8_t i = 0; i < 3; i++) {
+        uint8_t heat_led = (heat && i == 2) ? LCD_DOT : 0;
+        uint8_t ch = ~(glyph(getChar(i)) | heat_led);
+
+        frame[i].segments = ch;
+        frame[i].anodes = visible ? LCD_ANODES[i] : 0; // turn off lcd
+        if(ch & (1 << 3)) { // set B pin if corresponding bit is set
+            frame[i].anodes |= 1 << LCDBPin::Number;
+        }
+    }
+
+    front ^= 1;
+    return nextField;
 }
 
-void Lcd::setDashes() {
-    chars[0] = Chars::Dash;
-    chars[1] = Chars::Dash;
-    chars[2] = Chars::Dash;
+void Lcd::setText(const char *text) {
+    if(text == message) {
+        return; // keep scrolling
+    }
+
+    message = text;
+    messageLength = strlen_P(text);
+    scroll = 0;
 }
 
-void Lcd::setValue(uint16_t value) {
+void Lcd::setValue(uint16_t number) {
     uint8_t buffer[5];
-    bin2bcd5(value, buffer);
+    bin2bcd5(number, buffer);
+    bcd2ascii(buffer);
 
-    chars[0] = didgits[buffer[2]];
-    chars[1] = didgits[buffer[3]];
-    chars[2] = didgits[buffer[4]];
+    message = nullptr;
+    value[0] = buffer[2];
+    value[1] = buffer[3];
+    value[2] = buffer[4];
+}
+
+uint8_t Lcd::getField(uint8_t count) {
+    return field % count;
 }
 
 void Lcd::setBlink(bool doBlink) {
     blink = doBlink;
 }
+
+bool Lcd::isBlinking() {
+    return blink;
+}
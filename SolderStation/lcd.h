@@ -4,14 +4,27 @@
 #include <avr/io.h>
 
 class Lcd {
+    private:
+        typedef struct {
+            uint8_t segments; // PORTB image
+            uint8_t anodes;   // anodes + B segment image
+        } Digit;
+
+        static Digit frames[2][3];
+        static volatile uint8_t front;
+        static volatile uint8_t lightTicks;
+
     public:
-        static void draw();
-        static void setValue(uint16_t value);
-        static void setOFF();
-        static void setSleep();
-        static void setSensorError();
-        static void setDashes();
+        static uint8_t draw();
+        static void blank();
+        static void setBrightness(uint8_t level);
+        static bool render(bool heat);
+        static void setValue(uint16_t number);
+        static void setText(const char *text); // PROGMEM string
+        static uint8_t getField(uint8_t count);
         static void setBlink(bool doBlink = true);
+        static bool isBlinking();
+        static char getChar(uint8_t index); // shown at the digit, the current scroll position of a message
 };
 
 #endif /* LCD_H_ */
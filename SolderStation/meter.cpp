@@ -0,0 +1,145 @@
+#include <avr/io.h>
+#include <util/atomic.h>
+#include <string.h>
+
+#include "meter.h"
+#include "Scheduler.h"
+#include "events.h"
+
+#ifdef SOFTUART
+    #include "softuart.hpp"
+#endif
+
+// Bump on every MeterData layout change, the counters start over
+const uint8_t METER_VERSION = 1;
+const uint16_t PARTS_PER_SECOND = 10000;
+
+volatile uint8_t Meter::crossings[HEATER_CHANNELS];
+volatile uint8_t Meter::firings[HEATER_CHANNELS];
+volatile uint16_t Meter::percents[HEATER_CHANNELS];
+
+Meter::MeterData Meter::data;
+uint16_t Meter::firingResidue[HEATER_CHANNELS];
+uint16_t Meter::energyResidue[HEATER_CHANNELS];
+uint16_t Meter::unsavedSeconds = 0;
+uint8_t Meter::poweredChannels = 0;
+bool Meter::dirty = false;
+uint8_t EEMEM Meter::journalData[METER_JOURNAL_SLOTS][JournalSlotSize];
+Journal Meter::journal(journalData, JournalSlotSize, METER_JOURNAL_SLOTS);
+
+void Meter::init() {
+    if(journal.load(&data, sizeof(data)) != METER_VERSION) {
+        memset(&data, 0, sizeof(data));
+    }
+
+    Events::subscribe(EVENT_SETTINGS | EVENT_STORAGE, process);
+    Scheduler::setTimer(update, 1000, true);
+}
+
+// Once a second, the share of the second spent firing and at full power is taken from the
+// ratio to the crossings counted, so the mains frequency does not matter
+void Meter::update() {
+    bool heating = false;
+    uint8_t powered = 0;
+    for(uint8_t i = 0; i < HEATER_CHANNELS; i++) {
+        uint8_t cycles;
+        uint8_t fired;
+        uint16_t percent;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            cycles = crossings[i];
+            fired = firings[i];
+            percent = percents[i];
+            crossings[i] = 0;
+            firings[i] = 0;
+            percents[i] = 0;
+        }
+
+        if(cycles == 0) {
+            continue;
+        }
+        powered |= 1 << i;
+
+        Counters &counters = data.channels[i];
+        counters.poweredSeconds++;
+        counters.firingSeconds += carry(firingResidue[i], static_cast<uint32_t>(fired) * PARTS_PER_SECOND / cycles);
+        counters.fullPowerSeconds += carry(energyResidue[i], static_cast<uint32_t>(percent) * (PARTS_PER_SECOND / 100) / cycles);
+        heating |= fired != 0;
+    }
+
+    // saved periodically while heating and when a channel loses its zero crossings (switched
+    // off, mains gone). A second without firing is not the end of heating, a regulated iron
+    // idles like that all the time.
+    if(heating) {
+        unsavedSeconds++;
+    }
+    bool switchedOff = (poweredChannels & ~powered) != 0;
+    poweredChannels = powered;
+    if(switchedOff || unsavedSeconds >= METER_SAVE_PERIOD) {
+        unsavedSeconds = 0;
+        dirty = true;
+        Events::post(EVENT_SETTINGS);
+    }
+
+#ifdef SOFTUART
+    static uint8_t delay = 0;
+    if(++delay >= 10) {
+        delay = 0;
+        print();
+    }
+#endif
+}
+
+// Adds the parts to the residue, returns the whole seconds taken out of it
+uint8_t Meter::carry(uint16_t &residue, uint16_t parts) {
+    uint8_t seconds = 0;
+    residue += parts;
+    while(residue >= PARTS_PER_SECOND) {
+        residue -= PARTS_PER_SECOND;
+        seconds++;
+    }
+    return seconds;
+}
+
+// Event handler, hands the counters to the journal once the previous record is written
+void Meter::process() {
+    if(dirty && journal.save(&data, sizeof(data), METER_VERSION)) {
+        dirty = false;
+    }
+}
+
+uint32_t Meter::getEnergy(uint8_t channel) {
+    uint32_t seconds = data.channels[channel].fullPowerSeconds;
+    uint16_t watts = (channel == FAN_CHANNEL) ? FAN_HEATER_WATTS : SOLDER_HEATER_WATTS;
+    return seconds / 3600 * watts + seconds % 3600 * watts / 3600; // without overflowing 32 bits
+}
+
+uint8_t Meter::getDuty(uint8_t channel) {
+    const Counters &counters = data.channels[channel];
+    if(counters.poweredSeconds == 0) {
+        return 0;
+    }
+    return counters.fullPowerSeconds * 100 / counters.poweredSeconds;
+}
+
+uint32_t Meter::getOnTime(uint8_t channel) {
+    return data.channels[channel].firingSeconds;
+}
+
+#ifdef SOFTUART
+// M,channel,Wh,duty %,on-time s,powered s
+void Meter::print() {
+    for(uint8_t i = 0; i < HEATER_CHANNELS; i++) {
+        Softuart::sendString("M,");
+        Softuart::sendValue(i);
+        Softuart::sendChar(',');
+        Softuart::sendLongValue(getEnergy(i));
+        Softuart::sendChar(',');
+        Softuart::sendValue(getDuty(i));
+        Softuart::sendChar(',');
+        Softuart::sendLongValue(getOnTime(i));
+        Softuart::sendChar(',');
+        Softuart::sendLongValue(data.channels[i].poweredSeconds);
+        Softuart::sendString("\r\n");
+    }
+}
+#endif
@@ -0,0 +1,68 @@
+#ifndef METER_H_
+#define METER_H_
+
+#include <avr/eeprom.h>
+
+#include "config.h"
+#include "journal.h"
+
+const uint8_t METER_JOURNAL_SLOTS = 3;
+
+// Lifetime energy and duty accounting of the heaters, from the power the arbiter granted at
+// every zero crossing: a phase angle percentage is delivered power by the equal-power PFC
+// table, a pulse skipped cycle is either 0 or 100 %. Kept as seconds, at full power for the
+// energy, and saved to a journal every METER_SAVE_PERIOD of heating and when a heater is
+// switched off.
+class Meter {
+    private:
+        typedef struct {
+            uint32_t poweredSeconds;   // switched on, zero crossings present
+            uint32_t firingSeconds;    // the element conducted, its on-time for the wear
+            uint32_t fullPowerSeconds; // delivered energy as time at full power
+        } Counters;
+
+        typedef struct {
+            Counters channels[HEATER_CHANNELS];
+        } MeterData;
+
+        enum { JournalSlotSize = Journal::HeaderSize + sizeof(MeterData) };
+
+        // since the previous update(), written by the zero-crossing ISRs
+        static volatile uint8_t crossings[HEATER_CHANNELS];
+        static volatile uint8_t firings[HEATER_CHANNELS];
+        static volatile uint16_t percents[HEATER_CHANNELS];
+
+        static MeterData data;
+        static uint16_t firingResidue[HEATER_CHANNELS]; // 1/10000 s
+        static uint16_t energyResidue[HEATER_CHANNELS];
+        static uint16_t unsavedSeconds;
+        static uint8_t poweredChannels; // bit per channel, zero crossings in the previous second
+        static bool dirty;
+        static uint8_t EEMEM journalData[METER_JOURNAL_SLOTS][JournalSlotSize];
+        static Journal journal;
+
+        static void update();
+        static void process();
+        static uint8_t carry(uint16_t &residue, uint16_t parts);
+
+    public:
+        static void init();
+
+        static inline void countISR(uint8_t channel, uint8_t power) {
+            crossings[channel]++;
+            if(power != 0) {
+                firings[channel]++;
+                percents[channel] += power;
+            }
+        }
+
+        static uint32_t getEnergy(uint8_t channel); // Wh
+        static uint8_t getDuty(uint8_t channel);    // % of the powered time at full power
+        static uint32_t getOnTime(uint8_t channel); // seconds
+
+#ifdef SOFTUART
+        static void print();
+#endif
+};
+
+#endif /* METER_H_ */
@@ -0,0 +1,81 @@
+#include <avr/pgmspace.h>
+
+#include "params.h"
+#include "config.h"
+#include "utils.h"
+#include "events.h"
+
+#ifdef SOFTUART
+    #include "softuart.hpp"
+#endif
+
+const Params::Info Params::info[PARAMS_COUNT] PROGMEM = {
+    // name   min   max   default
+    {"FtH",   20,   100,  FAN_THRESHOLD_TEMP},
+    {"FHy",   1,    50,   FAN_HYSTERESIS_TEMP},
+    {"Fto",   0,    60,   FAN_COOLING_TIMEOUT},
+    {"FLo",   0,    255,  FAN_AIR_FLOW_MIN},
+    {"FHi",   0,    255,  FAN_AIR_FLOW_MAX},
+    {"P",     0,    999,  FAN_PID_KP},
+    {"I",     0,    999,  FAN_PID_KI},
+    {"d",     0,    999,  FAN_PID_KD},
+    {"Lpd",   20,   250,  LONG_PRESS_DELAY},
+    {"br",    0,    LCD_BRIGHTNESS_MAX, LCD_BRIGHTNESS_NORMAL},
+    {"brS",   0,    LCD_BRIGHTNESS_MAX, LCD_BRIGHTNESS_STANDBY},
+};
+
+// Bump when the meaning of a stored value changes, appended parameters start from their defaults
+const uint8_t PARAMS_VERSION = 1;
+
+int16_t Params::values[PARAMS_COUNT];
+bool Params::dirty = false;
+uint8_t EEMEM Params::journalData[PARAMS_JOURNAL_SLOTS][JournalSlotSize];
+Journal Params::journal(journalData, JournalSlotSize, PARAMS_JOURNAL_SLOTS);
+
+void Params::init() {
+    uint8_t storedSize;
+    uint8_t version = journal.load(values, sizeof(values), &storedSize);
+    uint8_t stored = (version == PARAMS_VERSION) ? storedSize / sizeof(values[0]) : 0;
+
+    for(uint8_t i = 0; i < PARAMS_COUNT; i++) {
+        int16_t min = pgm_read_word(&info[i].min);
+        int16_t max = pgm_read_word(&info[i].max);
+        if(i >= stored || values[i] < min || values[i] > max) {
+            values[i] = pgm_read_word(&info[i].def);
+        }
+    }
+
+    Events::subscribe(EVENT_SETTINGS | EVENT_STORAGE, process);
+}
+
+// Event handler, hands the values to the journal once the previous record is written
+void Params::process() {
+    if(dirty && journal.save(values, sizeof(values), PARAMS_VERSION)) {
+        dirty = false;
+    }
+}
+
+void Params::set(Param id, int16_t value) {
+    value = clamp(value, static_cast<int16_t>(pgm_read_word(&info[id].min)), static_cast<int16_t>(pgm_read_word(&info[id].max)));
+    values[id] = value;
+}
+
+void Params::save() {
+    dirty = true;
+    Events::post(EVENT_SETTINGS);
+}
+
+const char *Params::getName(Param id) {
+    return info[id].name;
+}
+
+#ifdef SOFTUART
+void Params::print() {
+    for(uint8_t i = 0; i < PARAMS_COUNT; i++) {
+        Softuart::sendStringP(info[i].name);
+        Softuart::sendChar('=');
+        Softuart::sendValue(values[i]);
+        Softuart::sendString("\r\n");
+    }
+}
+#endif
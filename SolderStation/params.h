@@ -0,0 +1,64 @@
+#ifndef PARAMS_H_
+#define PARAMS_H_
+
+#include <avr/eeprom.h>
+
+#include "journal.h"
+
+// New parameters go to the end (before PARAMS_COUNT), stored records are indexed by id
+enum Param {
+    PARAM_FAN_THRESHOLD,
+    PARAM_FAN_HYSTERESIS,
+    PARAM_FAN_COOLING_TIMEOUT,
+    PARAM_FAN_AIR_FLOW_MIN,
+    PARAM_FAN_AIR_FLOW_MAX,
+    PARAM_FAN_KP,
+    PARAM_FAN_KI,
+    PARAM_FAN_KD,
+    PARAM_LONG_PRESS_DELAY,
+    PARAM_LCD_BRIGHTNESS,
+    PARAM_LCD_STANDBY_BRIGHTNESS,
+    PARAMS_COUNT
+};
+
+const uint8_t PARAMS_JOURNAL_SLOTS = 3;
+
+class Params {
+    private:
+        typedef struct {
+            char name[4]; // shown on the display
+            int16_t min;
+            int16_t max;
+            int16_t def;
+        } Info;
+
+        enum { JournalSlotSize = Journal::HeaderSize + PARAMS_COUNT * sizeof(int16_t) };
+
+        static const Info info[PARAMS_COUNT];
+        static int16_t values[PARAMS_COUNT];
+        static bool dirty;
+        static uint8_t EEMEM journalData[PARAMS_JOURNAL_SLOTS][JournalSlotSize];
+        static Journal journal;
+
+    public:
+        static void init();
+        static void process();
+
+        // a constant id compiles to a single RAM load
+        static inline int16_t get(Param id) {
+            return values[id];
+        }
+
+        static void set(Param id, int16_t value);
+        static void save();
+        static const char *getName(Param id); // PROGMEM string
+
+        static const Journal &getJournal() {
+            return journal;
+        }
+#ifdef SOFTUART
+        static void print();
+#endif
+};
+
+#endif /* PARAMS_H_ */
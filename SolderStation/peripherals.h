@@ -1,27 +1,20 @@
 #ifndef PERIPHERALS_H_
 #define PERIPHERALS_H_
 
-enum Button { NONE = 0, UP = 1, DOWN = 2, SET = 3 };
+#include "config.h"
+#include "heater.hpp"
+
+typedef HeaterChannel<FAN_CHANNEL, FanHeaterPin, FAN_TEMP_ADC_CH, ExtInt1, PhaseAngle> FanHeater;
+typedef HeaterChannel<SOLDER_CHANNEL, SolderHeaterPin, SOLDER_TEMP_ADC_CH, ExtInt0, PulseSkip> SolderHeater;
 
 class Peripherals {
     public:
         static void init();
-        static bool isFanSwitchOn();
-        static bool isSolderSwitchOn();
         static bool isFanOnSeat();
-        static bool isFanSensorOk();
-        static bool isSolderSensorOk();
+        static bool isHeating();
         static void setAirFlowVelocity(uint8_t velocity);
-        static void setFanPower(uint8_t power_percentage);
-        static void setSolderPower(uint8_t power_percentage);
+        static uint8_t getAirFlowVelocity();
         static uint16_t getAirFlowAjustment();
-        static uint16_t getSolderAdc();
-        static uint16_t getFanAdc();
-        static uint16_t getSolderAverageAdc();
-        static uint16_t getFanAverageAdc();
-        static uint16_t getSolderTemp();
-        static uint16_t getFanTemp();
-        static Button getButton();
 };
 
 #endif /* PERIPHERALS_H_ */
@@ -0,0 +1,165 @@
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdlib.h>
+
+#include "profile.h"
+#include "config.h"
+#include "events.h"
+#include "peripherals.h"
+
+#ifdef SOFTUART
+    #include "softuart.hpp"
+#endif
+
+const uint8_t PROFILE_PERIOD = 100; // ms
+
+const Profile::Info PROFILES[] PROGMEM = {
+    // name   count  {rate, target, hold, air flow}
+    {"PrE",   1,     {{10, 150, 600, 30}}},                                        // board preheat
+    {"rFL",   4,     {{10, 150, 0, 30}, {5, 200, 0, 30}, {15, 245, 30, 50}, {0, 100, 0, 100}}}, // lead-free reflow
+    {"rPb",   4,     {{10, 150, 0, 30}, {5, 180, 0, 30}, {15, 220, 30, 50}, {0, 100, 0, 100}}}, // leaded reflow
+};
+const uint8_t PROFILES_COUNT = sizeof(PROFILES) / sizeof(PROFILES[0]);
+
+Profile::State Profile::state = Profile::IDLE;
+uint8_t Profile::selected = 0;
+uint8_t Profile::segment = 0;
+int32_t Profile::ramp = 0;
+bool Profile::rising = true;
+bool Profile::scheduled = false;
+Deadline Profile::hold;
+
+void Profile::select(bool next) {
+    if(next) {
+        selected = (selected + 1 < PROFILES_COUNT) ? selected + 1 : 0;
+    } else {
+        selected = (selected > 0) ? selected - 1 : PROFILES_COUNT - 1;
+    }
+}
+
+const char *Profile::getName() {
+    return PROFILES[selected].name;
+}
+
+// The ramp starts from the current reading
+void Profile::start(uint16_t temp) {
+    ramp = static_cast<int32_t>(temp) * 100;
+    enter(0);
+    schedule();
+}
+
+void Profile::stop() {
+    state = State::IDLE;
+}
+
+void Profile::enter(uint8_t index) {
+    segment = index;
+    state = State::RAMP;
+    rising = static_cast<int32_t>(pgm_read_word(&current()->target)) * 100 > ramp;
+    Events::post(EVENT_DISPLAY);
+}
+
+const Profile::Segment *Profile::current() {
+    return &PROFILES[selected].segments[segment];
+}
+
+// Runs as a one-shot timer that arms itself again while the profile runs. Without a free
+// timer the profile stops, a setpoint nothing moves any more must not be held.
+void Profile::schedule() {
+    if(!scheduled) {
+        scheduled = Scheduler::setTimer(process, PROFILE_PERIOD);
+    }
+    if(!scheduled) {
+        state = State::IDLE;
+        Events::post(EVENT_DISPLAY);
+    }
+}
+
+void Profile::process() {
+    scheduled = false;
+    if(state == State::IDLE) {
+        return;
+    }
+
+    const Segment *step = current();
+    uint16_t target = pgm_read_word(&step->target);
+    uint16_t temp = FanHeater::getTemp();
+
+    if(state == State::RAMP) {
+        int32_t end = static_cast<int32_t>(target) * 100;
+        uint8_t rate = pgm_read_byte(&step->rate);
+        if(rate == 0) {
+            ramp = end;
+        } else if(rising) {
+            ramp = (ramp + rate < end) ? ramp + rate : end; // rate is 0.01 degrees per 100 ms
+        } else {
+            ramp = (ramp - rate > end) ? ramp - rate : end;
+        }
+
+        bool reached = rising ? temp + PROFILE_SETTLE_BAND >= target : temp <= target + PROFILE_SETTLE_BAND;
+        if(ramp == end && reached) {
+            state = State::HOLD;
+            hold.start(pgm_read_word(&step->hold) * 1000UL);
+            Events::post(EVENT_DISPLAY);
+        }
+    } else if(hold.expire()) {
+        if(segment + 1 < pgm_read_byte(&PROFILES[selected].count)) {
+            enter(segment + 1);
+        } else {
+            state = State::IDLE;
+            Events::post(EVENT_DISPLAY);
+        }
+    }
+
+#ifdef SOFTUART // R,segment,state,setpoint,temperature once a second
+    static uint8_t delay = 0;
+    if(++delay >= 10 || state == State::IDLE) {
+        delay = 0;
+        Softuart::sendString("R,");
+        Softuart::sendValue(segment);
+        Softuart::sendChar(',');
+        Softuart::sendValue(state);
+        Softuart::sendChar(',');
+        Softuart::sendValue(getSetpoint());
+        Softuart::sendChar(',');
+        Softuart::sendValue(temp);
+        Softuart::sendString("\r\n");
+    }
+#endif
+
+    if(state != State::IDLE) {
+        schedule();
+    }
+}
+
+bool Profile::isRunning() {
+    return state != State::IDLE;
+}
+
+Profile::State Profile::getState() {
+    return state;
+}
+
+uint8_t Profile::getSegment() {
+    return segment;
+}
+
+// The ramp setpoint PROFILE_LOOKAHEAD seconds ahead, not beyond the segment target
+uint16_t Profile::getSetpoint() {
+    const Segment *step = current();
+    int32_t end = static_cast<int32_t>(pgm_read_word(&step->target)) * 100;
+    int32_t setpoint = ramp;
+    if(state == State::RAMP) {
+        int32_t ahead = static_cast<int32_t>(pgm_read_byte(&step->rate)) * 10 * PROFILE_LOOKAHEAD;
+        if(rising) {
+            setpoint = (ramp + ahead < end) ? ramp + ahead : end;
+        } else {
+            setpoint = (ramp - ahead > end) ? ramp - ahead : end;
+        }
+    }
+    return (setpoint + 50) / 100;
+}
+
+uint8_t Profile::getAirFlow() {
+    return pgm_read_byte(&current()->airFlow);
+}
@@ -0,0 +1,58 @@
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdint.h>
+
+#include "clock.h"
+
+const uint8_t PROFILE_SEGMENTS = 6; // per profile
+
+// Time-temperature profiles of the hot air gun, ramp-soak-peak sequences of segments stored
+// in the program memory. A running profile is a scheduler task of its own that moves a ramp
+// setpoint at the segment rate towards the target, then holds the target for the segment
+// time once the reading is there. The fan PID is given the ramp setpoint PROFILE_LOOKAHEAD
+// seconds ahead, so it follows the ramp without lagging behind it.
+class Profile {
+    public:
+        enum State {IDLE, RAMP, HOLD};
+
+        typedef struct {
+            uint8_t rate;     // 0.1 degrees per second, 0 steps to the target
+            uint16_t target;
+            uint16_t hold;    // seconds at the target
+            uint8_t airFlow;  // % of the air flow range
+        } Segment;
+
+        typedef struct {
+            char name[4];     // shown on the display
+            uint8_t count;
+            Segment segments[PROFILE_SEGMENTS];
+        } Info;
+
+    private:
+        static State state;
+        static uint8_t selected;
+        static uint8_t segment;
+        static int32_t ramp;  // 0.01 degrees
+        static bool rising;
+        static bool scheduled;
+        static Deadline hold;
+
+        static void process();
+        static void schedule();
+        static void enter(uint8_t index);
+        static const Segment *current();
+
+    public:
+        static void select(bool next);
+        static const char *getName(); // PROGMEM string of the selected profile
+        static void start(uint16_t temp);
+        static void stop();
+        static bool isRunning();
+        static State getState();
+        static uint8_t getSegment();
+        static uint16_t getSetpoint();
+        static uint8_t getAirFlow();
+};
+
+#endif /* PROFILE_H_ */
@@ -0,0 +1,230 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "sampler.h"
+#include "adc.hpp"
+#include "buttons.h"
+#include "latency.hpp"
+
+const uint8_t ADC_DECIMATION = ADC_OVERSAMPLING_SAMPLES >> ADC_OVERSAMPLING_BITS; // 4^n samples give n extra bits
+const uint8_t ADC_WINDOW_MS = (ADC_OVERSAMPLING_SAMPLES * ADC_CONVERSION_US + 999) / 1000;
+const uint8_t ADC_SYNC_TIMEOUT = 20; // ms without a zero crossing, windows are self-timed then
+const uint8_t ADC_VARIANCE_DIVISOR = (ADC_OVERSAMPLING_SAMPLES * ADC_OVERSAMPLING_SAMPLES) >> (2 * ADC_OVERSAMPLING_BITS);
+const uint8_t ADC_VARIANCE_SMOOTHING = 3; // 1/8 of a new window variance goes in
+
+volatile bool Sampler::busy = false;
+volatile bool Sampler::buttonsConversion = false;
+volatile bool Sampler::acquiring = false;
+volatile uint32_t Sampler::accumulator;
+volatile uint32_t Sampler::squares;
+uint32_t Sampler::sums[HEATER_CHANNELS];
+uint8_t Sampler::windows[HEATER_CHANNELS];
+uint8_t Sampler::windowsShift[HEATER_CHANNELS];
+Seqlock<Sampler::Reading> Sampler::readings[HEATER_CHANNELS];
+uint8_t Sampler::channels[HEATER_CHANNELS];
+AdcFilter Sampler::filters[HEATER_CHANNELS];
+uint8_t Sampler::slot = 0;
+uint8_t Sampler::phase = 0;
+uint8_t Sampler::windowStart = ADC_SYNC_OFFSET;
+
+void Sampler::init() {
+    Adc::Init(0, Adc::Div64, Adc::Internal);
+    Adc::Enable();
+}
+
+void Sampler::setChannel(uint8_t slot, uint8_t channel) {
+    channels[slot] = channel;
+}
+
+// Called from the zero-crossing ISRs with the delay of the triac firing in this half-cycle.
+// Both heaters see the same crossing, the later window start wins.
+void Sampler::zeroCrossISR(uint16_t firingDelay) {
+    uint8_t start = ADC_SYNC_OFFSET;
+    uint8_t firing = (firingDelay == SAMPLER_NO_FIRING) ? UINT8_MAX : firingDelay >> 10; // ms of 1024 us, no division in the ISR
+    if(firing + 1 >= ADC_SYNC_OFFSET - 1 && firing < ADC_SYNC_OFFSET + ADC_WINDOW_MS) {
+        start = firing + 2; // tick phase jitter is up to 1 ms
+    }
+
+    if(phase < ADC_SYNC_OFFSET) { // the same crossing from the other channel
+        if(start > windowStart) {
+            windowStart = start;
+        }
+        return;
+    }
+
+    phase = 0;
+    windowStart = start;
+}
+
+// Called from the 1 ms timer ISR
+void Sampler::tickISR() {
+    bool windowDue;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { // the zero-crossing ISRs may reset the phase meanwhile
+        if(++phase >= ADC_SYNC_TIMEOUT) {
+            phase = 0; // no mains sync, the heaters are off
+        }
+        windowDue = phase == windowStart;
+    }
+
+    if(windowDue && isFree()) {
+        startWindow();
+    }
+}
+
+bool Sampler::isFree() {
+    return !busy && !buttonsConversion && !acquiring && Adc::ResultReady();
+}
+
+// A window of 4 conversions lasts exactly 13 fan PWM periods, so whole windows
+// average out the airflow PWM ripple
+void Sampler::startWindow() {
+    if(++slot == HEATER_CHANNELS) {
+        slot = 0;
+    }
+
+    Adc::SetChannel(channels[slot]);
+    accumulator = 0;
+    squares = 0;
+    acquiring = true;
+    Adc::EnableInterrupt();
+    Adc::StartContinuousConversions();
+}
+
+// Called from the timer ISR
+void Sampler::startButtonsConversion() {
+    if(!isFree()) {
+        return; // the previous level is used for this sample
+    }
+
+    Adc::SetChannel(BUTTONS_ADC_CH);
+    buttonsConversion = true;
+    ADCSRA |= (1 << ADIE) | (1 << ADSC);
+}
+
+void Sampler::acquire() {
+    busy = true;
+    while(buttonsConversion || acquiring || !Adc::ResultReady()); // let a started conversion finish
+}
+
+void Sampler::release() {
+    busy = false;
+}
+
+// Accumulates the running window one conversion at a time,
+// optionally through a median of the last three conversions against spikes
+void Sampler::conversionISR() {
+    LATENCY_START();
+    static uint8_t count = 0;
+    static uint16_t previous[2];
+
+    uint16_t sample = ADC;
+    if(buttonsConversion) {
+        ADCSRA &= ~(1 << ADIE);
+        buttonsConversion = false;
+        Buttons::conversionISR(sample);
+        return;
+    }
+
+    if(ADC_MEDIAN_FILTER) {
+        if(count == 0) {
+            previous[0] = previous[1] = sample;
+        }
+
+        uint16_t a = previous[0], b = previous[1];
+        previous[0] = b;
+        previous[1] = sample;
+        if(a > b) {
+            uint16_t t = a; a = b; b = t;
+        }
+        sample = (sample < a) ? a : (sample > b) ? b : sample;
+    }
+
+    accumulator += sample;
+    squares += static_cast<uint32_t>(sample) * sample;
+    if(++count < ADC_OVERSAMPLING_SAMPLES) {
+        LATENCY_STOP(LATENCY_ADC);
+        return;
+    }
+
+    ADCSRA &= ~((1 << ADFR) | (1 << ADIE)); // stop
+    count = 0;
+    LATENCY_STOP(LATENCY_ADC);
+
+    // The window statistics run with interrupts enabled. No conversion can start
+    // until acquiring is cleared, so this handler is not entered again meanwhile.
+    sei();
+
+    // n * sum(x^2) - sum(x)^2 = n^2 * variance, fits 32 bits for 16 bit sums
+    uint32_t spread = ADC_OVERSAMPLING_SAMPLES * squares - accumulator * accumulator;
+    uint32_t variance = spread / ADC_VARIANCE_DIVISOR;
+    finishWindow((accumulator + ADC_DECIMATION / 2) / ADC_DECIMATION, variance > UINT16_MAX ? UINT16_MAX : variance);
+    acquiring = false;
+}
+
+// Adds the window to the reading of its slot, publishes the reading when it has all
+// its windows and adapts the window count of the next one to the measured noise
+void Sampler::finishWindow(uint16_t value, uint16_t variance) {
+    Reading reading = readings[slot].get();
+    int32_t smoothed = reading.variance;
+    smoothed += (static_cast<int32_t>(variance) - smoothed) >> ADC_VARIANCE_SMOOTHING;
+    reading.variance = smoothed;
+
+    sums[slot] += value;
+    bool complete = ++windows[slot] == (1 << windowsShift[slot]);
+    if(complete) {
+        reading.value = filters[slot].update(sums[slot] >> windowsShift[slot]);
+        sums[slot] = 0;
+        windows[slot] = 0;
+    }
+    readings[slot].write(reading);
+
+    if(!complete) {
+        return;
+    }
+
+    uint8_t noise = squareRoot(reading.variance);
+    if(noise > ADC_NOISE_HIGH && (1 << windowsShift[slot]) < ADC_WINDOWS_MAX) {
+        windowsShift[slot]++;
+    } else if(noise < ADC_NOISE_LOW && windowsShift[slot] > 0) {
+        windowsShift[slot]--;
+    }
+}
+
+ISR(ADC_vect) {
+    Sampler::conversionISR();
+}
+
+uint16_t Sampler::read(uint8_t channel) {
+    acquire();
+    Adc::SetChannel(channel);
+    uint16_t value = Adc::SingleConversion();
+    release();
+    return value;
+}
+
+// Integer square root, bit by bit
+uint8_t Sampler::squareRoot(uint16_t value) {
+    uint8_t root = 0;
+    for(uint8_t bit = 0x80; bit != 0; bit >>= 1) {
+        uint8_t trial = root | bit;
+        if(static_cast<uint16_t>(trial) * trial <= value) {
+            root = trial;
+        }
+    }
+    return root;
+}
+
+// RMS noise inside a window in ADC_OVERSAMPLING_BITS LSBs, before the averaging
+uint8_t Sampler::getNoise(uint8_t slot) {
+    return squareRoot(readings[slot].read().variance);
+}
+
+uint8_t Sampler::getWindows(uint8_t slot) {
+    return 1 << windowsShift[slot];
+}
+
+// Latest filtered reading of the slot with ADC_OVERSAMPLING_BITS fraction bits
+uint16_t Sampler::get(uint8_t slot) {
+    return readings[slot].read().value;
+}
@@ -0,0 +1,78 @@
+#ifndef SAMPLER_H_
+#define SAMPLER_H_
+
+#include <stdint.h>
+
+#include "config.h"
+#include "shared.hpp"
+
+const uint16_t SAMPLER_NO_FIRING = UINT16_MAX;
+
+// First order low-pass for the decimated readings, the state keeps ADC_IIR_SHIFT fraction bits
+class AdcFilter {
+    private:
+        uint32_t state;
+
+    public:
+        uint16_t update(uint16_t value) {
+            if(ADC_IIR_SHIFT == 0) {
+                return value;
+            }
+
+            if(state == 0) { // start from the first reading, not from zero
+                state = static_cast<uint32_t>(value) << ADC_IIR_SHIFT;
+            }
+            state += value - (state >> ADC_IIR_SHIFT);
+            return state >> ADC_IIR_SHIFT;
+        }
+};
+
+// Owns the ADC. Temperature channels are acquired in the background, one oversampling
+// window per mains half-cycle at a fixed phase after the zero crossing, clear of the
+// triac firing. The timer ISR squeezes button conversions in between, the main loop
+// takes the ADC for single conversions.
+// A reading averages 1 to ADC_WINDOWS_MAX windows of its channel, more while the
+// noise measured inside the windows is high, fewer while the signal is quiet.
+class Sampler {
+    private:
+        typedef struct {
+            uint16_t value;
+            uint16_t variance; // smoothed, in squared ADC_OVERSAMPLING_BITS LSBs
+        } Reading;
+
+        static volatile bool busy;
+        static volatile bool buttonsConversion;
+        static volatile bool acquiring;
+        static volatile uint32_t accumulator;
+        static volatile uint32_t squares;
+        static uint8_t channels[HEATER_CHANNELS];
+        static AdcFilter filters[HEATER_CHANNELS];
+        static uint32_t sums[HEATER_CHANNELS];       // decimated windows of the reading in progress
+        static uint8_t windows[HEATER_CHANNELS];     // windows taken for it
+        static uint8_t windowsShift[HEATER_CHANNELS]; // 2^n windows per reading
+        static Seqlock<Reading> readings[HEATER_CHANNELS];
+        static uint8_t slot;
+        static uint8_t phase;       // ms since the last zero crossing
+        static uint8_t windowStart; // ms after the zero crossing
+
+        static bool isFree();
+        static void acquire();
+        static void release();
+        static void startWindow();
+        static void finishWindow(uint16_t value, uint16_t variance);
+        static uint8_t squareRoot(uint16_t value);
+
+    public:
+        static void init();
+        static void setChannel(uint8_t slot, uint8_t channel);
+        static void zeroCrossISR(uint16_t firingDelay);
+        static void tickISR();
+        static void startButtonsConversion();
+        static void conversionISR();
+        static uint16_t read(uint8_t channel);
+        static uint16_t get(uint8_t slot);
+        static uint8_t getNoise(uint8_t slot);
+        static uint8_t getWindows(uint8_t slot);
+};
+
+#endif /* SAMPLER_H_ */
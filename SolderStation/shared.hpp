@@ -0,0 +1,111 @@
+#ifndef SHARED_H_
+#define SHARED_H_
+
+#include <stdint.h>
+#include <util/atomic.h>
+
+// Primitives for data shared between ISRs and the main loop. AVR moves data a byte at a
+// time, so anything wider than a byte can be read torn unless one of these is used.
+
+// Keeps the compiler from moving memory accesses across it
+#define SHARED_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+// Reads a multi-byte value written by an ISR from a context the ISR can interrupt.
+// Reads it until two reads agree, interrupts stay enabled.
+template <class T>
+inline T atomicRead(const volatile T &value) {
+    T first, second;
+    do {
+        first = value;
+        second = value;
+    } while(first != second);
+    return first;
+}
+
+// Writes a multi-byte value read by an ISR, interrupts are masked for the few stores only
+template <class T>
+inline void atomicWrite(volatile T &variable, T value) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        variable = value;
+    }
+}
+
+// Single producer, single consumer ring buffer. Each side writes only its own index, so
+// an ISR and the main loop need no locking. SIZE is a power of 2 up to 128.
+template <class T, uint8_t SIZE>
+class SpscQueue {
+    static_assert(SIZE != 0 && (SIZE & (SIZE - 1)) == 0 && SIZE <= 128, "SIZE must be a power of 2");
+
+    private:
+        T items[SIZE];
+        volatile uint8_t head; // written by the producer
+        volatile uint8_t tail; // written by the consumer
+
+    public:
+        bool push(const T &item) {
+            uint8_t h = head;
+            if(static_cast<uint8_t>(h - tail) == SIZE) {
+                return false;
+            }
+
+            items[h & (SIZE - 1)] = item;
+            SHARED_BARRIER(); // the item is in place before the consumer can see it
+            head = h + 1;
+            return true;
+        }
+
+        bool pop(T &item) {
+            uint8_t t = tail;
+            if(t == head) {
+                return false;
+            }
+
+            SHARED_BARRIER();
+            item = items[t & (SIZE - 1)];
+            SHARED_BARRIER(); // the item is copied before the producer can reuse the slot
+            tail = t + 1;
+            return true;
+        }
+
+        bool isEmpty() const {
+            return head == tail;
+        }
+};
+
+// Multi-byte snapshot written by an ISR and read by the main loop. The writer makes the
+// sequence odd while it updates, the reader retries until it got a stable even sequence.
+template <class T>
+class Seqlock {
+    private:
+        T value;
+        volatile uint8_t sequence;
+
+    public:
+        // From the ISR, or with the reader unable to interrupt the writer
+        void write(const T &newValue) {
+            sequence++;
+            SHARED_BARRIER();
+            value = newValue;
+            SHARED_BARRIER();
+            sequence++;
+        }
+
+        T read() const {
+            uint8_t start;
+            T snapshot;
+            do {
+                start = sequence;
+                SHARED_BARRIER();
+                snapshot = value;
+                SHARED_BARRIER();
+            } while((start & 1) || start != sequence);
+            return snapshot;
+        }
+
+        // For the writer side itself, which never sees an update in progress
+        const T &get() const {
+            return value;
+        }
+};
+
+#endif /* SHARED_H_ */
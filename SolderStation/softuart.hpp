@@ -2,7 +2,9 @@
 #define SOFTUART_H_
 
 #include <avr/sfr_defs.h>
+#include <avr/pgmspace.h>
 #include "util/atomic.h"
+#include "utils.h"
 
 #define SOFTUART_PORT PORTB
 #define SOFTUART_DDR DDRB
@@ -72,6 +74,39 @@ class Softuart {
             }
         }
 
+        static void sendStringP(const char* str) {
+            while(char ch = pgm_read_byte(str++)) {
+                sendChar(ch);
+            }
+        }
+
+        static void sendValue(uint16_t value) {
+            uint8_t buffer[5];
+            bin2bcd5(value, buffer);
+            bcd2ascii(buffer);
+
+            uint8_t i = 0;
+            while(i < 4 && buffer[i] == '0') { // skip leading zeros
+                i++;
+            }
+            while(i < 5) {
+                sendChar(buffer[i++]);
+            }
+        }
+
+        static void sendLongValue(uint32_t value) {
+            uint8_t buffer[10];
+            bin2bcd10(value, buffer);
+
+            uint8_t i = 0;
+            while(i < 9 && buffer[i] == 0) { // skip leading zeros
+                i++;
+            }
+            while(i < 10) {
+                sendChar('0' + buffer[i++]);
+            }
+        }
+
         static void init() {
             SOFTUART_DDR |= (1 << SOFTUART_PIN);
             SOFTUART_PORT |= (1 << SOFTUART_PIN);
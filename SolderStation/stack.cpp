@@ -0,0 +1,40 @@
+#include <avr/io.h>
+
+#include "stack.h"
+
+const uint8_t STACK_CANARY = 0xc5;
+
+extern uint8_t _end;    // end of .bss, set by the linker
+extern uint8_t __stack; // RAMEND
+
+// In .init1 neither the stack pointer nor __zero_reg__ are set up yet, so registers only
+void paintStack() __attribute__((naked, used, section(".init1")));
+void paintStack() {
+    asm volatile (
+        "ldi r30, lo8(_end)"     "\n\t"
+        "ldi r31, hi8(_end)"     "\n\t"
+        "ldi r24, %[canary]"     "\n\t"
+        "ldi r25, hi8(__stack)"  "\n\t"
+        "rjmp 2f"                "\n\t"
+        "1: st Z+, r24"          "\n\t"
+        "2: cpi r30, lo8(__stack)" "\n\t"
+        "cpc r31, r25"           "\n\t"
+        "brlo 1b"                "\n\t"
+        "breq 1b"                "\n\t"
+        :: [canary] "M" (STACK_CANARY)
+    );
+}
+
+uint16_t Stack::getSize() {
+    return &__stack - &_end + 1;
+}
+
+uint16_t Stack::getUnused() {
+    const uint8_t *bottom = &_end;
+    uint16_t size = getSize();
+    uint16_t count = 0;
+    while(count < size && bottom[count] == STACK_CANARY) {
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,17 @@
+#ifndef STACK_H_
+#define STACK_H_
+
+#include <stdint.h>
+
+// Stack high-water mark. The RAM between the end of the static data and the top of the
+// stack is painted with a canary before the C runtime starts, so the canaries still left
+// at the bottom are the bytes the stack has never reached, ISRs included. There is no heap,
+// the static data is what the stack could run into. tools/ramreport.py gives the static
+// sizes per module and the worst call depth from the build.
+class Stack {
+    public:
+        static uint16_t getSize();   // bytes between the static data and RAMEND
+        static uint16_t getUnused(); // of them, never touched since the reset
+};
+
+#endif /* STACK_H_ */
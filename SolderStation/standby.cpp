@@ -0,0 +1,67 @@
+#include <avr/io.h>
+
+#include "standby.h"
+#include "config.h"
+#include "events.h"
+
+uint16_t Standby::lastTemp = 0;
+uint16_t Standby::lastSetupTemp = 0;
+uint8_t Standby::ticks = 0;
+uint8_t Standby::heatingTicks = 0;
+bool Standby::settled = false;
+bool Standby::active = false;
+Deadline Standby::idle;
+
+uint16_t Standby::process(uint16_t temp, uint16_t setupTemp, uint8_t power) {
+    if(setupTemp != lastSetupTemp) { // a new setpoint is activity too
+        lastSetupTemp = setupTemp;
+        wake();
+    }
+
+    uint16_t target = (active && SOLDER_STANDBY_TEMP < setupTemp) ? SOLDER_STANDBY_TEMP : setupTemp;
+    if(temp + SOLDER_SETTLE_BAND >= target) {
+        settled = true;
+    }
+
+    if(power != 0) {
+        heatingTicks++;
+    }
+    if(++ticks < 10) {
+        return target;
+    }
+
+    // once a second
+    if(settled && isLoaded(temp, target)) {
+        wake();
+    }
+    ticks = 0;
+    heatingTicks = 0;
+    lastTemp = temp;
+
+    if(idle.expire()) {
+        active = true;
+        settled = false;
+        Events::post(EVENT_DISPLAY);
+    }
+    return target;
+}
+
+bool Standby::isLoaded(uint16_t temp, uint16_t target) {
+    return (heatingTicks != 0 && lastTemp >= temp + SOLDER_LOAD_DROP) || // falling although heated
+           temp + SOLDER_LOAD_DIP < target ||
+           heatingTicks >= ticks;
+}
+
+// The timeout starts over, from standby the iron heats back to the setpoint
+void Standby::wake() {
+    idle.start(SOLDER_IDLE_TIMEOUT * 1000UL);
+    settled = false;
+    if(active) {
+        active = false;
+        Events::post(EVENT_DISPLAY);
+    }
+}
+
+bool Standby::isActive() {
+    return active;
+}
@@ -0,0 +1,33 @@
+#ifndef STANDBY_H_
+#define STANDBY_H_
+
+#include <stdint.h>
+
+#include "clock.h"
+
+// Idle detection of the soldering iron. Once the tip has settled at its target, real work
+// shows as a load signature: the temperature drops fast although heated or falls clearly
+// below the target, or the heater runs at full power for a whole second. Without one for
+// SOLDER_IDLE_TIMEOUT the target drops to SOLDER_STANDBY_TEMP, the next signature or any
+// button wakes it to the setpoint again at full power.
+class Standby {
+    private:
+        static uint16_t lastTemp;   // a second ago
+        static uint16_t lastSetupTemp;
+        static uint8_t ticks;
+        static uint8_t heatingTicks;
+        static bool settled;
+        static bool active;
+        static Deadline idle;
+
+        static bool isLoaded(uint16_t temp, uint16_t target);
+
+    public:
+        // Every 100 ms while the iron is on, with the reading, the setpoint and the power applied
+        // since the previous call. Returns the temperature to hold.
+        static uint16_t process(uint16_t temp, uint16_t setupTemp, uint8_t power);
+        static void wake();
+        static bool isActive();
+};
+
+#endif /* STANDBY_H_ */
@@ -0,0 +1,84 @@
+#include <stdlib.h>
+
+#include "sweep.h"
+#include "calibrator.h"
+#include "config.h"
+
+const uint16_t CALIBRATION_SWEEP[] = {150, 250, 350, 450};
+const uint8_t SWEEP_STEPS = sizeof(CALIBRATION_SWEEP) / sizeof(CALIBRATION_SWEEP[0]);
+
+static_assert(SWEEP_STEPS <= CALIBRATION_POINTS, "sweep does not fit in the calibration table");
+
+Sweep::State Sweep::state = Sweep::IDLE;
+uint8_t Sweep::channel;
+uint8_t Sweep::step;
+uint8_t Sweep::settleTicks;
+uint32_t Sweep::adcSum;
+uint16_t Sweep::adc[SWEEP_STEPS];
+uint16_t Sweep::temp[SWEEP_STEPS];
+
+void Sweep::start(uint8_t heaterChannel) {
+    channel = heaterChannel;
+    step = 0;
+    settleTicks = 0;
+    adcSum = 0;
+    state = State::SETTLING;
+}
+
+void Sweep::stop() {
+    state = State::IDLE;
+}
+
+// Called every 100 ms with the averaged adc reading and its current conversion
+void Sweep::process(uint16_t adcValue, uint16_t currentTemp) {
+    if(state != State::SETTLING) {
+        return;
+    }
+
+    if(abs(static_cast<int16_t>(currentTemp - getSetpoint())) > SWEEP_SETTLE_BAND) {
+        settleTicks = 0;
+        adcSum = 0;
+        return;
+    }
+
+    adcSum += adcValue;
+    if(++settleTicks < SWEEP_SETTLE_TIME) {
+        return;
+    }
+
+    adc[step] = adcSum / SWEEP_SETTLE_TIME;
+    state = State::REFERENCE;
+}
+
+void Sweep::confirm(uint16_t referenceTemp) {
+    if(state != State::REFERENCE) {
+        return;
+    }
+
+    temp[step] = referenceTemp;
+    if(++step < SWEEP_STEPS) {
+        settleTicks = 0;
+        adcSum = 0;
+        state = State::SETTLING;
+        return;
+    }
+
+    Calibrator::setPoints(channel, adc, temp, SWEEP_STEPS);
+    state = State::DONE;
+}
+
+Sweep::State Sweep::getState() {
+    return state;
+}
+
+uint8_t Sweep::getChannel() {
+    return channel;
+}
+
+uint8_t Sweep::getStep() {
+    return step;
+}
+
+uint16_t Sweep::getSetpoint() {
+    return CALIBRATION_SWEEP[step < SWEEP_STEPS ? step : SWEEP_STEPS - 1];
+}
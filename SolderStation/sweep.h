@@ -0,0 +1,32 @@
+#ifndef SWEEP_H_
+#define SWEEP_H_
+
+#include <stdint.h>
+
+// Automated calibration: steps the heater through CALIBRATION_SWEEP setpoints,
+// waits until the reading settles and asks the operator for the reference temperature.
+class Sweep {
+    public:
+        enum State {IDLE, SETTLING, REFERENCE, DONE};
+
+    private:
+        static State state;
+        static uint8_t channel;
+        static uint8_t step;
+        static uint8_t settleTicks;
+        static uint32_t adcSum;
+        static uint16_t adc[];
+        static uint16_t temp[];
+
+    public:
+        static void start(uint8_t heaterChannel);
+        static void stop();
+        static void process(uint16_t adcValue, uint16_t currentTemp);
+        static void confirm(uint16_t referenceTemp);
+        static State getState();
+        static uint8_t getChannel();
+        static uint8_t getStep();
+        static uint16_t getSetpoint();
+};
+
+#endif /* SWEEP_H_ */
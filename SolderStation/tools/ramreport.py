@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+# RAM budget of the firmware build, run after linking (post-build event of the project).
+#
+#   static RAM per module: .data and .bss of every object file, from the linker map
+#   stack: worst call depth from the -fstack-usage frames (*.su) and the call graph of the
+#          disassembled elf, for the main loop tasks and the interrupt handlers
+#
+# The stack estimate is the deepest task under Scheduler::run, plus the handlers that
+# enable interrupts again (the deferred 1 ms tick and the ADC window end) nested on each
+# other, plus a second tick on top of them: it only advances the clock before the running
+# guard returns, so it costs the vector's own frame. The deepest of the remaining handlers
+# comes on top of that. Calls through task and handler pointers are resolved to
+# INDIRECT_TARGETS, keep it in sync with the setTimer, setTask and subscribe calls.
+#
+# usage: ramreport.py <elf> <map> <directory of the .su files> [objdump]
+
+import re
+import subprocess
+import sys
+from pathlib import Path
+
+RAM_SIZE = 1024
+RETURN_ADDRESS = 2
+
+INDIRECT_TARGETS = [
+    'loop10ms', 'loop100ms', 'updateSwitches', 'Events::dispatch',
+    'processSwitches', 'processButtons', 'saveSettings', 'processLEDs',
+    'Calibrator::process', 'Params::process', 'Meter::process', 'Meter::update', 'Profile::process',
+]
+
+# ATmega8 vectors
+VECTORS = {
+    '__vector_1': 'INT0', '__vector_2': 'INT1', '__vector_6': 'TIMER1_COMPA', '__vector_7': 'TIMER1_COMPB',
+    '__vector_9': 'TIMER0_OVF', '__vector_14': 'ADC', '__vector_15': 'EE_RDY',
+}
+REENTRANT = ['__vector_7', '__vector_14'] # sei() inside
+TICK_VECTOR = '__vector_7'
+
+
+def short_name(name):
+    """Qualified function name without return type and parameters."""
+    name = name.split('(')[0].strip()
+    return name.split(' ')[-1]
+
+
+def static_ram(map_file):
+    modules = {}
+    section = None
+    for line in Path(map_file).read_text(errors='replace').splitlines():
+        match = re.match(r'^ (\.data|\.bss|\.noinit|COMMON)\S*\s*(0x[0-9a-f]+)?\s*(0x[0-9a-f]+)?\s*(\S+)?$', line)
+        if match:
+            section = match.group(1)
+            if match.group(3) and match.group(4):
+                size = int(match.group(3), 16)
+                module = Path(match.group(4).split('(')[0]).name
+                if size and not match.group(4).startswith('*'):
+                    modules[module] = modules.get(module, 0) + size
+            continue
+        if section:
+            match = re.match(r'^\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)\s+(\S+)$', line)
+            if match:
+                size = int(match.group(2), 16)
+                module = Path(match.group(3).split('(')[0]).name
+                if size:
+                    modules[module] = modules.get(module, 0) + size
+            section = None
+    return modules
+
+
+def frames(su_directory):
+    sizes = {}
+    for su in Path(su_directory).rglob('*.su'):
+        for line in su.read_text(errors='replace').splitlines():
+            parts = line.split('\t')
+            if len(parts) < 2:
+                continue
+            name = short_name(parts[0].split(':', 3)[-1])
+            sizes[name] = max(sizes.get(name, 0), int(parts[1]))
+    return sizes
+
+
+def call_graph(elf, objdump):
+    output = subprocess.run([objdump, '-d', '-C', elf], capture_output=True, text=True, check=True).stdout
+    graph = {}
+    current = None
+    for line in output.splitlines():
+        match = re.match(r'^[0-9a-f]+ <(.+)>:$', line)
+        if match:
+            current = short_name(match.group(1))
+            graph.setdefault(current, set())
+            continue
+        if current is None:
+            continue
+        match = re.search(r'\b(r?call)\b.*<([^>+]+)(\+0x[0-9a-f]+)?>', line)
+        if match:
+            graph[current].add(short_name(match.group(2)))
+        elif re.search(r'\b(e?icall)\b', line):
+            graph[current].update(INDIRECT_TARGETS)
+    return graph
+
+
+def depth(function, graph, sizes, path=(), known={}):
+    if function in known:
+        return known[function]
+    if function in path:
+        print('warning: recursion through ' + function)
+        return 0
+    deepest = 0
+    for callee in graph.get(function, ()):
+        deepest = max(deepest, RETURN_ADDRESS + depth(callee, graph, sizes, path + (function,)))
+    known[function] = sizes.get(function, 0) + deepest
+    return known[function]
+
+
+def main():
+    if len(sys.argv) < 4:
+        print('usage: ramreport.py <elf> <map> <su directory> [objdump]')
+        return 1
+    elf, map_file, su_directory = sys.argv[1:4]
+    objdump = sys.argv[4] if len(sys.argv) > 4 else 'avr-objdump'
+
+    modules = static_ram(map_file)
+    print('Static RAM per module')
+    for module, size in sorted(modules.items(), key=lambda item: -item[1]):
+        print('  %-24s %5d' % (module, size))
+    static = sum(modules.values())
+    print('  %-24s %5d' % ('total', static))
+
+    sizes = frames(su_directory)
+    graph = call_graph(elf, objdump)
+
+    print('Worst stack depth')
+    thread = depth('main', graph, sizes)
+    print('  %-24s %5d' % ('main and tasks', thread))
+    handlers = {}
+    for vector, name in VECTORS.items():
+        if vector in graph:
+            handlers[vector] = RETURN_ADDRESS + depth(vector, graph, sizes)
+            print('  %-24s %5d' % (name, handlers[vector]))
+
+    nested = sum(handlers.get(vector, 0) for vector in REENTRANT)
+    tick_again = RETURN_ADDRESS + sizes.get(TICK_VECTOR, 0) if TICK_VECTOR in handlers else 0
+    print('  %-24s %5d' % ('TIMER1_COMPB nested', tick_again))
+    others = [size for vector, size in handlers.items() if vector not in REENTRANT]
+    stack = thread + nested + tick_again + max(others, default=0)
+    print('  %-24s %5d' % ('worst case', stack))
+
+    headroom = RAM_SIZE - static - stack
+    print('Headroom %d bytes' % headroom)
+    return 0 if headroom > 0 else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,201 @@
+#include <string.h>
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+
+#include "board.h"
+#include "config.h"
+#include "Scheduler.h"
+#include "clock.h"
+#include "events.h"
+#include "sampler.h"
+#include "buttons.h"
+#include "calibrator.h"
+#include "params.h"
+
+const uint8_t TASKS_PER_STEP = 64;   // more than a ms of queued tasks can hold
+const uint8_t BUTTON_EVENTS = 16;
+
+#define REPLAY_DEFINE8(name) volatile uint8_t name;
+#define REPLAY_DEFINE16(name) volatile uint16_t name;
+REPLAY_REGISTERS(REPLAY_DEFINE8, REPLAY_DEFINE16)
+
+extern "C" {
+    void TIMER1_COMPB_vect(void);
+    void INT0_vect(void);
+    void INT1_vect(void);
+    void EE_RDY_vect(void);
+}
+
+void setup();
+
+static uint16_t adcReadings[HEATER_CHANNELS];
+static uint16_t airFlowKnob;
+static Button bootButton;
+static Buttons::Event buttonEvents[BUTTON_EVENTS];
+static uint8_t buttonHead;
+static uint8_t buttonTail;
+
+// Sampler: the readings of the trace, taken as they are
+void Sampler::init() {}
+void Sampler::setChannel(uint8_t, uint8_t) {}
+void Sampler::zeroCrossISR(uint16_t) {}
+void Sampler::tickISR() {}
+void Sampler::startButtonsConversion() {}
+void Sampler::conversionISR() {}
+
+uint16_t Sampler::read(uint8_t channel) {
+    return (channel == FAN_AIR_ADC_CH) ? airFlowKnob : 1023;
+}
+
+uint16_t Sampler::get(uint8_t slot) {
+    return adcReadings[slot];
+}
+
+uint8_t Sampler::getNoise(uint8_t) {
+    return 0;
+}
+
+uint8_t Sampler::getWindows(uint8_t) {
+    return 1;
+}
+
+// Buttons: the events of the trace, as the firmware handled them
+void Buttons::init(uint16_t) {}
+void Buttons::setHoldDelay(uint8_t) {}
+
+bool Buttons::tickISR() {
+    return false;
+}
+
+bool Buttons::getEvent(Event &event) {
+    if(buttonTail == buttonHead) {
+        return false;
+    }
+    event = buttonEvents[buttonTail++ % BUTTON_EVENTS];
+    return true;
+}
+
+Button Buttons::getState() {
+    return bootButton;
+}
+
+// EEPROM: the journals the settings are loaded from, erased anywhere else
+static bool region(const Journal &journal, const void *address, size_t size) {
+    const uint8_t *start = journal.getStart();
+    const uint8_t *byte = static_cast<const uint8_t *>(address);
+    return byte >= start && byte + size <= start + journal.getLength();
+}
+
+void eeprom_read_block(void *destination, const void *source, size_t size) {
+    if(region(Calibrator::getJournal(), source, size) || region(Params::getJournal(), source, size)) {
+        memcpy(destination, source, size);
+    } else {
+        memset(destination, 0xff, size);
+    }
+}
+
+uint8_t eeprom_read_byte(const uint8_t *address) {
+    uint8_t value;
+    eeprom_read_block(&value, address, 1);
+    return value;
+}
+
+// The lines the firmware captures
+static char line[256];
+static uint8_t lineLength;
+
+void replayPut(char ch) {
+    if(ch == '\r') {
+        return;
+    }
+    if(ch == '\n') {
+        line[lineLength] = '\0';
+        lineLength = 0;
+        replayLine(line);
+        return;
+    }
+    if(lineLength < sizeof(line) - 1) {
+        line[lineLength++] = ch;
+    }
+}
+
+void Board::init() {
+    memset(Calibrator::getJournal().getStart(), 0xff, Calibrator::getJournal().getLength());
+    memset(Params::getJournal().getStart(), 0xff, Params::getJournal().getLength());
+    PINC = 0xff; // pull-ups, the gun is off the seat
+}
+
+bool Board::loadStore(char name, uint16_t offset, const uint8_t *data, uint8_t size) {
+    const Journal *journal = nullptr;
+    if(name == 'C') {
+        journal = &Calibrator::getJournal();
+    } else if(name == 'P') {
+        journal = &Params::getJournal();
+    }
+
+    if(journal == nullptr || offset + size > journal->getLength()) {
+        return false;
+    }
+    memcpy(journal->getStart() + offset, data, size);
+    return true;
+}
+
+void Board::boot(uint8_t button, uint32_t ms) {
+    while(Clock::millis() < ms) {
+        Clock::tickISR();
+    }
+    bootButton = static_cast<Button>(button);
+    setup();
+}
+
+void Board::setSeat(bool onSeat) {
+    if(onSeat) {
+        PINC &= ~(1 << FanSeatSwitchPin::Number);
+    } else {
+        PINC |= 1 << FanSeatSwitchPin::Number;
+    }
+}
+
+void Board::setReadings(uint16_t fanAdc, uint16_t solderAdc, uint16_t airFlow) {
+    adcReadings[FAN_CHANNEL] = fanAdc;
+    adcReadings[SOLDER_CHANNEL] = solderAdc;
+    airFlowKnob = airFlow;
+}
+
+void Board::pushButton(uint8_t button, uint8_t action, uint8_t step) {
+    if(static_cast<uint8_t>(buttonHead - buttonTail) == BUTTON_EVENTS) {
+        return;
+    }
+    Buttons::Event &event = buttonEvents[buttonHead++ % BUTTON_EVENTS];
+    event.button = static_cast<Button>(button);
+    event.action = static_cast<Buttons::Action>(action);
+    event.step = step;
+    Events::post(EVENT_BUTTON);
+}
+
+// Timer1 is set to the time of the crossing, so Clock::micros() stamps it as the station did
+void Board::zeroCross(uint8_t channel, uint16_t us) {
+    TCNT1 = OCR1B - CLOCK_US_PER_TICK + us;
+    if(channel == FAN_CHANNEL) {
+        INT1_vect();
+    } else {
+        INT0_vect();
+    }
+}
+
+void Board::step() {
+    if(EECR & (1 << EERIE)) {
+        EE_RDY_vect();
+    }
+
+    TCNT1 = OCR1B;
+    TIMER1_COMPB_vect();
+    for(uint8_t i = 0; i < TASKS_PER_STEP; i++) {
+        Scheduler::processTasks();
+    }
+}
+
+uint32_t Board::millis() {
+    return Clock::millis();
+}
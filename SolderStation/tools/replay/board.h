@@ -0,0 +1,31 @@
+#ifndef REPLAY_BOARD_H_
+#define REPLAY_BOARD_H_
+
+#include <stdint.h>
+
+// The hardware behind the control modules in the host replay. The sampler, the buttons and
+// the EEPROM are stood in for, everything else is the firmware built for the host. Only
+// plain types cross this interface, the firmware side is built with the AVR packing options.
+class Board {
+    public:
+        static void init();
+
+        // A captured journal, before boot(). False when it does not fit the host layout.
+        static bool loadStore(char name, uint16_t offset, const uint8_t *data, uint8_t size);
+        static void boot(uint8_t button, uint32_t ms); // clock at ms, then the firmware setup
+
+        static void setSeat(bool onSeat);
+        static void setReadings(uint16_t fanAdc, uint16_t solderAdc, uint16_t airFlow);
+        static void pushButton(uint8_t button, uint8_t action, uint8_t step);
+
+        // A zero crossing us after the start of the current ms, before its step()
+        static void zeroCross(uint8_t channel, uint16_t us);
+        // One ms: the EEPROM writer, the tick and the tasks it queued
+        static void step();
+        static uint32_t millis();
+};
+
+// Called with every line the firmware captures, without the line end
+void replayLine(const char *line);
+
+#endif /* REPLAY_BOARD_H_ */
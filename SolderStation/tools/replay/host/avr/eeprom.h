@@ -0,0 +1,16 @@
+#ifndef REPLAY_AVR_EEPROM_H_
+#define REPLAY_AVR_EEPROM_H_
+
+// The EEMEM arrays are ordinary RAM on the host, the replay board serves reads from them
+// and ignores the writes of the background writer, nothing reads them back after the boot
+
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+
+#define EEMEM
+
+void eeprom_read_block(void *destination, const void *source, size_t size);
+uint8_t eeprom_read_byte(const uint8_t *address);
+
+#endif /* REPLAY_AVR_EEPROM_H_ */
@@ -0,0 +1,12 @@
+#ifndef REPLAY_AVR_INTERRUPT_H_
+#define REPLAY_AVR_INTERRUPT_H_
+
+// Handlers become plain functions the replay board calls, nothing preempts on the host
+
+#include <avr/io.h>
+
+#define ISR(vector, ...) extern "C" void vector(void); void vector(void)
+#define sei()
+#define cli()
+
+#endif /* REPLAY_AVR_INTERRUPT_H_ */
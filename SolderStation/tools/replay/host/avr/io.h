@@ -0,0 +1,34 @@
+#ifndef REPLAY_AVR_IO_H_
+#define REPLAY_AVR_IO_H_
+
+// Host stand-in for the ATmega8 registers, plain variables defined by the replay board
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define REPLAY_REGISTERS(R8, R16) \
+    R8(PORTB) R8(DDRB) R8(PINB) R8(PORTC) R8(DDRC) R8(PINC) R8(PORTD) R8(DDRD) R8(PIND) \
+    R8(TCNT0) R8(TCCR0) R8(TIMSK) R8(TIFR) R8(TCCR1A) R8(TCCR1B) R16(TCNT1) R16(OCR1A) R16(OCR1B) \
+    R8(TCCR2) R8(OCR2) R8(TCNT2) R8(ADMUX) R8(ADCSRA) R16(ADC) R8(MCUCR) R8(GICR) \
+    R8(EECR) R16(EEAR) R8(EEDR)
+
+#define REPLAY_DECLARE8(name) extern volatile uint8_t name;
+#define REPLAY_DECLARE16(name) extern volatile uint16_t name;
+REPLAY_REGISTERS(REPLAY_DECLARE8, REPLAY_DECLARE16)
+
+enum {
+    REFS1 = 7, REFS0 = 6, ADLAR = 5, MUX3 = 3, MUX2 = 2, MUX1 = 1, MUX0 = 0,
+    ADEN = 7, ADSC = 6, ADFR = 5, ADIF = 4, ADIE = 3, ADPS2 = 2, ADPS1 = 1, ADPS0 = 0,
+    CS02 = 2, CS01 = 1, CS00 = 0,
+    OCIE2 = 7, TOIE2 = 6, TICIE1 = 5, OCIE1A = 4, OCIE1B = 3, TOIE1 = 2, TOIE0 = 0,
+    OCF2 = 7, TOV2 = 6, ICF1 = 5, OCF1A = 4, OCF1B = 3, TOV1 = 2, TOV0 = 0,
+    CS12 = 2, CS11 = 1, CS10 = 0,
+    WGM20 = 6, COM21 = 5, COM20 = 4, WGM21 = 3, CS22 = 2, CS21 = 1, CS20 = 0,
+    ISC11 = 3, ISC10 = 2, ISC01 = 1, ISC00 = 0, INT1 = 7, INT0 = 6,
+    EERIE = 3, EEMWE = 2, EEWE = 1, EERE = 0,
+    PORTB5 = 5, PINB5 = 5
+};
+
+#define _BV(bit) (1 << (bit))
+
+#endif /* REPLAY_AVR_IO_H_ */
@@ -0,0 +1,13 @@
+#ifndef REPLAY_AVR_PGMSPACE_H_
+#define REPLAY_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_word(address) (*(const uint16_t *)(address))
+#define strlen_P strlen
+
+#endif /* REPLAY_AVR_PGMSPACE_H_ */
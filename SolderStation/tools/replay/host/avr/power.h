@@ -0,0 +1,4 @@
+#ifndef REPLAY_AVR_POWER_H_
+#define REPLAY_AVR_POWER_H_
+
+#endif /* REPLAY_AVR_POWER_H_ */
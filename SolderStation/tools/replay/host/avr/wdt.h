@@ -0,0 +1,8 @@
+#ifndef REPLAY_AVR_WDT_H_
+#define REPLAY_AVR_WDT_H_
+
+#define WDTO_120MS 3
+#define wdt_enable(timeout)
+#define wdt_reset()
+
+#endif /* REPLAY_AVR_WDT_H_ */
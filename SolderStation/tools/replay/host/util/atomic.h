@@ -0,0 +1,9 @@
+#ifndef REPLAY_UTIL_ATOMIC_H_
+#define REPLAY_UTIL_ATOMIC_H_
+
+// Single threaded on the host, the block runs once
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_BLOCK(type) for(bool replayOnce = true; replayOnce; replayOnce = false)
+
+#endif /* REPLAY_UTIL_ATOMIC_H_ */
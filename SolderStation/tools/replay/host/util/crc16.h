@@ -0,0 +1,15 @@
+#ifndef REPLAY_UTIL_CRC16_H_
+#define REPLAY_UTIL_CRC16_H_
+
+#include <stdint.h>
+
+// Same polynomial as avr-libc, the CRCs of the captured journals must check
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t data) {
+    crc ^= data;
+    for(uint8_t i = 0; i < 8; i++) {
+        crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+    }
+    return crc;
+}
+
+#endif /* REPLAY_UTIL_CRC16_H_ */
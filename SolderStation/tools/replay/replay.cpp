@@ -0,0 +1,395 @@
+// Host replay of a field trace (see capture.hpp). The captured EEPROM journals and the boot
+// button set up the station, the captured readings, zero crossings, seat switch and button
+// events are fed to the control modules at the times they had on the station, and the lines
+// the replay captures are compared with the traced ones field by field.
+//
+// usage: replay <trace>           exits 1 on any difference
+//        replay --record <trace>  prints the replayed stream instead, a trace of H, I and B
+//                                 lines alone is enough input for a new golden trace
+//
+// Without E lines the EEPROM is erased. Tick k of the replay runs at 100 (k + 1) ms after
+// the setup, the station's times are shifted onto that per tick. The readings of its I line
+// are applied just before it and the seat 50 ms before it. The zero crossing stamps give
+// the phase of the mains: the crossings since the previous tick are replayed at the stamp
+// and every MAINS_PERIOD_US before it, back to the previous tick's stamp. A channel that
+// had none then starts at the stamp alone, or back to the previous tick when its switch
+// already reads on. A button event keeps its distance to the next tick. The times are not
+// compared, the crossing stamps are, shifted like the tick.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "board.h"
+
+const uint32_t TICK_PERIOD = 100;      // ms, loop100ms
+const uint32_t SEAT_LEAD = 50;         // ms, the seat switch is read every 10 ms
+const uint32_t MAINS_PERIOD_US = 20000; // 50 Hz, one crossing per cycle and channel
+const uint8_t CHANNELS = 2;            // fan, solder; the field order of I lines
+const size_t CROSSING_FIELD = 6;
+const unsigned MAX_REPORTED = 20;
+
+typedef std::vector<std::string> Fields;
+
+struct Record {
+    char tag;
+    Fields fields; // fields[0] is the tag
+};
+
+struct Crossing {
+    uint32_t ms;  // delivered before the step at this millis()
+    uint16_t us;  // into that ms
+    uint8_t channel;
+
+    bool operator<(const Crossing &other) const {
+        return (ms != other.ms) ? ms < other.ms : us < other.us;
+    }
+};
+
+struct Button {
+    uint32_t at;
+    uint8_t button;
+    uint8_t action;
+    uint8_t step;
+};
+
+static const char *const I_NAMES[] = {"tag", "ms", "fan adc", "solder adc", "air flow knob", "switches",
+                                      "fan crossing", "solder crossing"};
+static const char *const B_NAMES[] = {"tag", "ms", "button", "action", "step"};
+static const char *const O_NAMES[] = {"tag", "ms", "fan power", "solder power", "air flow pwm", "mode", "fan mode",
+                                      "faults", "standby", "profile state", "segment", "display", "blink"};
+static const char *const E_NAMES[] = {"tag", "store", "offset", "data"};
+static const char *const H_NAMES[] = {"tag", "ms", "button"};
+
+static std::vector<Record> replayed;
+
+static const char *const *fieldNames(char tag, size_t &count) {
+    switch(tag) {
+        case 'I': count = sizeof(I_NAMES) / sizeof(I_NAMES[0]); return I_NAMES;
+        case 'B': count = sizeof(B_NAMES) / sizeof(B_NAMES[0]); return B_NAMES;
+        case 'O': count = sizeof(O_NAMES) / sizeof(O_NAMES[0]); return O_NAMES;
+        case 'E': count = sizeof(E_NAMES) / sizeof(E_NAMES[0]); return E_NAMES;
+        case 'H': count = sizeof(H_NAMES) / sizeof(H_NAMES[0]); return H_NAMES;
+        default: count = 0; return nullptr;
+    }
+}
+
+static bool isCompared(size_t field) {
+    return field != 1; // ms
+}
+
+// The display of an O line may hold commas, it is the three characters before the last one
+static bool parse(const std::string &text, Record &record) {
+    size_t count;
+    if(text.size() < 2 || text[1] != ',' || fieldNames(text[0], count) == nullptr) {
+        return false; // debug output of a SOFTUART build
+    }
+
+    record.tag = text[0];
+    record.fields.clear();
+    size_t end = text.size();
+    std::string tail;
+    if(record.tag == 'O') {
+        size_t last = text.rfind(',');
+        if(last < 4) {
+            return false;
+        }
+        tail = text.substr(last + 1);
+        end = last - 4;
+    }
+
+    size_t start = 0;
+    while(true) {
+        size_t comma = text.find(',', start);
+        if(comma == std::string::npos || comma >= end) {
+            record.fields.push_back(text.substr(start, end - start));
+            break;
+        }
+        record.fields.push_back(text.substr(start, comma - start));
+        start = comma + 1;
+    }
+
+    if(record.tag == 'O') {
+        record.fields.push_back(text.substr(end + 1, 3));
+        record.fields.push_back(tail);
+    }
+    return record.fields.size() == count;
+}
+
+static uint32_t number(const Record &record, size_t field) {
+    return strtoul(record.fields[field].c_str(), nullptr, 10);
+}
+
+void replayLine(const char *line) {
+    Record record;
+    if(parse(line, record)) {
+        replayed.push_back(record);
+    }
+}
+
+static bool loadStore(const Record &record) {
+    const std::string &hex = record.fields[3];
+    uint8_t data[128];
+    size_t size = hex.size() / 2;
+    if(record.fields[1].size() != 1 || hex.size() % 2 != 0 || size > sizeof(data)) {
+        return false;
+    }
+    for(size_t i = 0; i < size; i++) {
+        data[i] = strtoul(hex.substr(i * 2, 2).c_str(), nullptr, 16);
+    }
+    return Board::loadStore(record.fields[1][0], number(record, 2), data, size);
+}
+
+static std::vector<Record> only(const std::vector<Record> &records, char tag) {
+    std::vector<Record> selected;
+    for(const Record &record : records) {
+        if(record.tag == tag) {
+            selected.push_back(record);
+        }
+    }
+    return selected;
+}
+
+static unsigned compare(char tag, const std::vector<Record> &all, unsigned reported) {
+    std::vector<Record> traced = only(all, tag);
+    std::vector<Record> ours = only(replayed, tag);
+    size_t namesCount;
+    const char *const *names = fieldNames(tag, namesCount);
+
+    unsigned differences = 0;
+    for(size_t i = 0; i < traced.size() && i < ours.size(); i++) {
+        for(size_t field = 0; field < namesCount; field++) {
+            if(!isCompared(field) || traced[i].fields[field] == ours[i].fields[field]) {
+                continue;
+            }
+            if(reported + differences < MAX_REPORTED) {
+                printf("%c %zu at %s ms: %s is '%s', replayed '%s'\n", tag, i, traced[i].fields[1].c_str(),
+                       names[field], traced[i].fields[field].c_str(), ours[i].fields[field].c_str());
+            }
+            differences++;
+        }
+    }
+
+    if(traced.size() != ours.size()) {
+        if(reported + differences < MAX_REPORTED) {
+            printf("%c: %zu lines traced, %zu replayed\n", tag, traced.size(), ours.size());
+        }
+        differences++;
+    }
+    return differences;
+}
+
+// The station's tick k is replayed at this time, shifted by the difference
+static uint32_t tickTime(uint32_t setupMs, size_t k) {
+    return setupMs + TICK_PERIOD * (k + 1);
+}
+
+static int32_t tickShift(const std::vector<const Record *> &ticks, uint32_t setupMs, size_t k) {
+    return static_cast<int32_t>(tickTime(setupMs, k) - number(*ticks[k], 1));
+}
+
+// The zero crossings since each tick's predecessor, from the stamps of the I lines
+static std::vector<Crossing> crossings(const std::vector<const Record *> &ticks, uint32_t setupMs) {
+    std::vector<Crossing> all;
+    for(uint8_t channel = 0; channel < CHANNELS; channel++) {
+        bool active = false;
+        uint32_t latest = 0;
+        uint16_t stamp = 0;
+        for(size_t k = 0; k < ticks.size(); k++) {
+            const Record &inputs = *ticks[k];
+            uint32_t stationMs = number(inputs, 1);
+            uint16_t now = number(inputs, CROSSING_FIELD + channel);
+            if(now == stamp) {
+                active = false; // none since the previous tick
+                continue;
+            }
+            stamp = now;
+
+            // the latest time before the tick with these low 16 bits
+            uint32_t tickUs = stationMs * 1000 + 999;
+            uint32_t crossed = tickUs - static_cast<uint16_t>(tickUs - now);
+            uint32_t previousUs = ((k == 0) ? stationMs - TICK_PERIOD : number(*ticks[k - 1], 1)) * 1000 + 999;
+            uint32_t from = crossed;
+            if(active) {
+                from = latest + MAINS_PERIOD_US / 2;
+            } else if(number(inputs, 5) & (1 << channel)) {
+                from = previousUs; // already switched on, so it has crossed for a while
+            }
+            latest = crossed;
+            active = true;
+
+            uint32_t tick = tickTime(setupMs, k);
+            int64_t shiftUs = static_cast<int64_t>(tickShift(ticks, setupMs, k)) * 1000;
+            for(uint32_t at = crossed; ; at -= MAINS_PERIOD_US) {
+                int64_t replayUs = at + shiftUs;
+                if(replayUs >= static_cast<int64_t>(setupMs) * 1000) {
+                    uint32_t ms = std::min(static_cast<uint32_t>(replayUs / 1000), tick - 1);
+                    all.push_back({ms, static_cast<uint16_t>(replayUs - static_cast<int64_t>(ms) * 1000), channel});
+                }
+                if(at <= from + MAINS_PERIOD_US || at < MAINS_PERIOD_US) {
+                    break;
+                }
+            }
+        }
+    }
+    std::sort(all.begin(), all.end());
+    return all;
+}
+
+static bool readTrace(const char *path, std::vector<Record> &records) {
+    FILE *file = fopen(path, "r");
+    if(file == nullptr) {
+        return false;
+    }
+
+    char buffer[512];
+    while(fgets(buffer, sizeof(buffer), file) != nullptr) {
+        buffer[strcspn(buffer, "\r\n")] = '\0';
+        Record record;
+        if(parse(buffer, record)) {
+            records.push_back(record);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    bool record = argc == 3 && strcmp(argv[1], "--record") == 0;
+    if(argc != 2 && !record) {
+        fprintf(stderr, "usage: replay [--record] <trace>\n");
+        return 2;
+    }
+
+    const char *path = argv[argc - 1];
+    std::vector<Record> trace;
+    if(!readTrace(path, trace)) {
+        fprintf(stderr, "%s: cannot read\n", path);
+        return 2;
+    }
+
+    Board::init();
+    uint8_t bootButton = 0;
+    std::vector<const Record *> ticks;
+    for(const Record &line : trace) {
+        if(line.tag == 'E' && !loadStore(line)) {
+            fprintf(stderr, "%s: store %s at %s does not fit\n", path, line.fields[1].c_str(), line.fields[2].c_str());
+            return 2;
+        }
+        if(line.tag == 'H') {
+            bootButton = number(line, 2);
+        }
+        if(line.tag == 'I') {
+            ticks.push_back(&line);
+        }
+    }
+    if(ticks.empty() || number(*ticks[0], 1) < TICK_PERIOD) {
+        fprintf(stderr, "%s: no control ticks\n", path);
+        return 2;
+    }
+
+    // A button event keeps its distance to the tick after it, inside the gap before that tick
+    uint32_t setupMs = number(*ticks[0], 1) - TICK_PERIOD;
+    std::vector<Crossing> mains = crossings(ticks, setupMs);
+    std::vector<Button> buttons;
+    size_t next = 0;
+    for(const Record &line : trace) {
+        if(line.tag == 'I') {
+            next++;
+            continue;
+        }
+        if(line.tag != 'B') {
+            continue;
+        }
+
+        uint32_t ms = number(line, 1);
+        uint32_t after = setupMs + TICK_PERIOD * next + 1;
+        uint32_t at;
+        if(next < ticks.size()) {
+            uint32_t tick = tickTime(setupMs, next);
+            uint32_t ahead = number(*ticks[next], 1) - ms;
+            at = (ahead >= tick - after) ? after : tick - ahead;
+        } else { // past the last tick, keeps its distance to it
+            uint32_t behind = ms - number(*ticks[next - 1], 1);
+            at = after + ((behind > 1) ? behind - 1 : 0);
+        }
+        if(!buttons.empty() && at < buttons.back().at) {
+            at = buttons.back().at;
+        }
+        buttons.push_back({at, static_cast<uint8_t>(number(line, 2)), static_cast<uint8_t>(number(line, 3)),
+                           static_cast<uint8_t>(number(line, 4))});
+    }
+
+    Board::boot(bootButton, setupMs);
+    uint32_t end = tickTime(setupMs, ticks.size() - 1);
+    if(!buttons.empty() && buttons.back().at > end) {
+        end = buttons.back().at;
+    }
+
+    size_t button = 0;
+    size_t crossing = 0;
+    while(Board::millis() < end) {
+        uint32_t now = Board::millis() + 1; // the time the next step runs at
+        uint32_t phase = now - setupMs;
+        size_t tick = (phase + TICK_PERIOD - 1) / TICK_PERIOD - 1;
+        if(tick < ticks.size()) {
+            const Record &inputs = *ticks[tick];
+            if(phase % TICK_PERIOD == TICK_PERIOD - SEAT_LEAD) {
+                Board::setSeat(number(inputs, 5) & (1 << 2));
+            }
+            if(phase % TICK_PERIOD == 0) {
+                Board::setReadings(number(inputs, 2), number(inputs, 3), number(inputs, 4));
+            }
+        }
+        while(button < buttons.size() && buttons[button].at <= now) {
+            Board::pushButton(buttons[button].button, buttons[button].action, buttons[button].step);
+            button++;
+        }
+        while(crossing < mains.size() && mains[crossing].ms <= Board::millis()) {
+            Board::zeroCross(mains[crossing].channel, mains[crossing].us);
+            crossing++;
+        }
+        Board::step();
+    }
+
+    if(record) {
+        for(const Record &line : replayed) {
+            std::string text;
+            for(size_t i = 0; i < line.fields.size(); i++) {
+                text += (i == 0) ? "" : ",";
+                text += line.fields[i];
+            }
+            printf("%s\n", text.c_str());
+        }
+        fprintf(stderr, "%s: %zu ticks, %zu button events replayed\n", path, ticks.size(), buttons.size());
+        return 0;
+    }
+
+    // the stamps are replayed shifted like their tick
+    size_t k = 0;
+    for(Record &line : trace) {
+        if(line.tag != 'I') {
+            continue;
+        }
+        for(uint8_t channel = 0; channel < CHANNELS; channel++) {
+            std::string &field = line.fields[CROSSING_FIELD + channel];
+            uint16_t stamp = strtoul(field.c_str(), nullptr, 10) + tickShift(ticks, setupMs, k) * 1000;
+            field = std::to_string(stamp);
+        }
+        k++;
+    }
+
+    // E and H are only loaded, the I and B lines show what the control modules were given
+    unsigned differences = 0;
+    const char tags[] = {'I', 'B', 'O'};
+    for(char tag : tags) {
+        differences += compare(tag, trace, differences);
+    }
+    printf("%s: %zu ticks, %zu button events, %u differences\n", path, ticks.size(), buttons.size(), differences);
+    return (differences == 0) ? 0 : 1;
+}